@@ -0,0 +1,523 @@
+// Times the collision hot paths one at a time on the same seeded scenes the simulator builds
+// Builds without SDL or TL-Engine. Results are JSON so runs can be diffed across commits
+//
+// kernel_benchmarks [--circles 250000,1000000] [--spawn 500,1000,2000] [--repeats 5] [--threads 8] [--seed 17052021] [--label name] [--out results.json]
+// --spawn is the half width of a square spawn range, so the same circle count over a bigger range is a lower density
+
+#include "collision_kernels.hpp"
+#include "defines.hpp"
+#include "density_raster.hpp"
+#include "frame_publisher.hpp"
+#include "scene.hpp"
+#include "simulation_config.hpp"
+#include "libraries/aligned_arena.hpp"
+#include "libraries/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct benchmark_options
+	{
+		std::vector<uint32_t>	circles = { 250000u, 1000000u, DEFAULT_NUM_OF_CIRCLES };
+		std::vector<float>		spawnHalfWidths = { 500.0f, 1000.0f, 2000.0f };
+		uint32_t				repeats = 5u;
+		uint32_t				threads = 0u;
+		uint32_t				seed = DEFAULT_SPAWN_SEED;
+		std::string				label;
+		std::string				outputPath;
+	};
+
+	struct benchmark_result
+	{
+		std::string			kernel;
+		uint32_t			circles = 0u;
+		float				spawnHalfWidth = 0.0f;
+		// What each item is differs by kernel e.g. one moving circle, one block or one dispatch
+		uint64_t			items = 0u;
+		std::vector<double>	seconds;
+		// Stops the compiler throwing the work away. Also a quick check that two commits did the same work
+		uint64_t			checksum = 0u;
+	};
+
+	// Moving circles that found a sweep start, and where
+	struct search_hit
+	{
+		uint32_t	movingIndex = 0u;
+		uint32_t	start = 0u;
+	};
+
+	const char* simd_name()
+	{
+	#if defined(COLLISION_KERNEL_AVX2)
+		return "avx2";
+	#elif defined(COLLISION_KERNEL_SSE)
+		return "sse";
+	#else
+		return "scalar";
+	#endif
+	}
+
+	template <typename T, typename Parse>
+	std::vector<T> parse_list(const std::string& value, Parse parse)
+	{
+		std::vector<T> values;
+		std::stringstream stream(value);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			values.push_back(parse(item));
+		}
+		if (values.empty())
+		{
+			throw std::runtime_error("Empty list '" + value + "'");
+		}
+		return values;
+	}
+
+	benchmark_options parse_options(int argc, char* argv[])
+	{
+		benchmark_options options;
+
+		for (auto i = 1; i < argc; ++i)
+		{
+			const std::string key = argv[i];
+			if (i + 1 == argc)
+			{
+				throw std::runtime_error("Option " + key + " is missing its value");
+			}
+			const std::string value = argv[++i];
+
+			if (key == "--circles")
+			{
+				options.circles = parse_list<uint32_t>(value, [](const std::string& item) { return static_cast<uint32_t>(std::stoul(item)); });
+			}
+			else if (key == "--spawn")
+			{
+				options.spawnHalfWidths = parse_list<float>(value, [](const std::string& item) { return std::stof(item); });
+			}
+			else if (key == "--repeats")
+			{
+				options.repeats = std::max(1u, static_cast<uint32_t>(std::stoul(value)));
+			}
+			else if (key == "--threads")
+			{
+				options.threads = static_cast<uint32_t>(std::stoul(value));
+			}
+			else if (key == "--seed")
+			{
+				options.seed = static_cast<uint32_t>(std::stoul(value));
+			}
+			else if (key == "--label")
+			{
+				options.label = value;
+			}
+			else if (key == "--out")
+			{
+				options.outputPath = value;
+			}
+			else
+			{
+				throw std::runtime_error("Unknown option " + key + ". Options are --circles, --spawn, --repeats, --threads, --seed, --label and --out");
+			}
+		}
+
+		if (options.threads == 0u)
+		{
+			options.threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		return options;
+	}
+
+	// Runs the kernel once to warm the caches then times it repeats times
+	template <typename Kernel>
+	benchmark_result time_kernel(const std::string& kernel, uint32_t repeats, uint64_t items, Kernel&& run)
+	{
+		benchmark_result result;
+		result.kernel = kernel;
+		result.items = items;
+
+		result.checksum = run();
+		for (auto r = 0u; r < repeats; ++r)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			const auto checksum = run();
+			result.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+			if (checksum != result.checksum)
+			{
+				throw std::runtime_error(kernel + " gave a different answer on repeat " + std::to_string(r));
+			}
+		}
+
+		std::cerr << '\t' << kernel << ": " << *std::min_element(result.seconds.begin(), result.seconds.end()) << "s\n";
+		return result;
+	}
+
+	// Same bounds process_collision_sweep uses
+	void sweep_bounds(const simulation_config& config, float mx, float mRadius, float& leftBound, float& rightBound)
+	{
+	#ifdef _RANDOM_RADIUS_
+		(void)mRadius;
+		leftBound = mx - config.max_collision_distance();
+		rightBound = mx + config.max_collision_distance();
+	#else
+		(void)config;
+		leftBound = mx - mRadius - mRadius;
+		rightBound = mx + mRadius + mRadius;
+	#endif
+	}
+
+	// Times each stationary collision kernel on one scene
+	void benchmark_scene(const benchmark_options& options, uint32_t circles, float spawnHalfWidth, std::vector<benchmark_result>& results)
+	{
+		simulation_config config;
+		config.set("circles", std::to_string(circles));
+		config.seed = options.seed;
+		config.xSpawnRange = Vector2f(-spawnHalfWidth, spawnHalfWidth);
+		config.ySpawnRange = Vector2f(-spawnHalfWidth, spawnHalfWidth);
+		config.validate();
+
+		std::cerr << "Scene: " << circles << " circles, spawn +-" << spawnHalfWidth << '\n';
+
+		aligned_arena arena(CACHE_LINE_SIZE);
+		stationary_collision_array sColData;
+		stationary_unique_array sUniqueData;
+		moving_collision_array mColData;
+		moving_unique_array mUniqueData;
+		{
+			thread_pool pool(options.threads - 1u);
+			generate_scene(config, pool, arena, sColData, sUniqueData, mColData, mUniqueData);
+		}
+
+		const auto numStationary = sColData.size();
+		const auto numMoving = mColData.size();
+		const auto firstResult = results.size();
+
+		// Binary search for every moving circle
+		std::vector<search_hit> searchHits;
+		results.push_back(time_kernel("binary_search", options.repeats, numMoving, [&]()
+		{
+			searchHits.clear();
+			uint64_t checksum = 0u;
+			for (auto i = 0u; i < numMoving; ++i)
+			{
+				float leftBound, rightBound;
+				sweep_bounds(config, mColData.x[i], mColData.radius[i], leftBound, rightBound);
+
+				size_t circleFound;
+				if (collision_kernels::find_sweep_start(sColData.x, numStationary, leftBound, rightBound, circleFound))
+				{
+					searchHits.push_back({ i, static_cast<uint32_t>(circleFound) });
+					checksum += circleFound;
+				}
+			}
+			return checksum;
+		}));
+
+		// Same searches through the breadth first tree. Has to find exactly the same starts
+		std::vector<collision_kernels::search_node> searchNodes(collision_kernels::sweep_search_index::slots_for(numStationary));
+		collision_kernels::sweep_search_index searchIndex;
+		searchIndex.build(sColData.x, numStationary, searchNodes.data());
+
+		results.push_back(time_kernel("eytzinger_search", options.repeats, numMoving, [&]()
+		{
+			uint64_t checksum = 0u;
+			for (auto i = 0u; i < numMoving; ++i)
+			{
+				float leftBound, rightBound;
+				sweep_bounds(config, mColData.x[i], mColData.radius[i], leftBound, rightBound);
+
+				size_t circleFound;
+				if (searchIndex.find(leftBound, rightBound, circleFound))
+				{
+					checksum += circleFound;
+				}
+			}
+			return checksum;
+		}));
+		if (results.back().checksum != results[results.size() - 2u].checksum)
+		{
+			throw std::runtime_error("eytzinger_search found different sweep starts to binary_search");
+		}
+
+		// Left and right sweeps from the starts found above, counting overlaps instead of resolving them
+		results.push_back(time_kernel("sweep", options.repeats, searchHits.size(), [&]()
+		{
+			uint64_t hits = 0u;
+			const auto onHit = [&](size_t) { ++hits; };
+			for (const auto& searchHit : searchHits)
+			{
+				const auto i = searchHit.movingIndex;
+				float leftBound, rightBound;
+				sweep_bounds(config, mColData.x[i], mColData.radius[i], leftBound, rightBound);
+
+				collision_kernels::sweep_right(sColData.x, sColData.y, sColData.radius, numStationary, searchHit.start, mColData.x[i], mColData.y[i], mColData.radius[i], rightBound, onHit);
+				collision_kernels::sweep_left(sColData.x, sColData.y, sColData.radius, searchHit.start, mColData.x[i], mColData.y[i], mColData.radius[i], leftBound, onHit);
+			}
+			return hits;
+		}));
+
+		// Same sweeps reading 16-bit fixed point positions. Checksum should match sweep
+		const auto quantizer = collision_kernels::position_quantizer::for_range(config.xSpawnRange.x(), config.xSpawnRange.y(), config.ySpawnRange.x(), config.ySpawnRange.y());
+		std::vector<uint32_t> packed(numStationary);
+		for (size_t s = 0; s < numStationary; ++s)
+		{
+			packed[s] = quantizer.pack(sColData.x[s], sColData.y[s]);
+		}
+		const float maxStationaryRadius = 0.5f * config.max_collision_distance();
+
+		results.push_back(time_kernel("sweep_quantized", options.repeats, searchHits.size(), [&]()
+		{
+			uint64_t hits = 0u;
+			const auto onHit = [&](size_t) { ++hits; };
+			for (const auto& searchHit : searchHits)
+			{
+				const auto i = searchHit.movingIndex;
+				float leftBound, rightBound;
+				sweep_bounds(config, mColData.x[i], mColData.radius[i], leftBound, rightBound);
+
+				collision_kernels::sweep_right_quantized(sColData.x, sColData.y, sColData.radius, packed.data(), quantizer, numStationary, searchHit.start, mColData.x[i], mColData.y[i], mColData.radius[i], maxStationaryRadius, rightBound, onHit);
+				collision_kernels::sweep_left_quantized(sColData.x, sColData.y, sColData.radius, packed.data(), quantizer, searchHit.start, mColData.x[i], mColData.y[i], mColData.radius[i], maxStationaryRadius, leftBound, onHit);
+			}
+			return hits;
+		}));
+
+		// One block of SWEEP_LANES candidates per moving circle, vector kernel against the scalar test
+		if (numStationary >= collision_kernels::SWEEP_LANES)
+		{
+			const auto blockStart = [&](const search_hit& searchHit)
+			{
+				return std::min<size_t>(searchHit.start, numStationary - collision_kernels::SWEEP_LANES);
+			};
+
+			results.push_back(time_kernel("narrow_phase_simd", options.repeats, searchHits.size(), [&]()
+			{
+				uint64_t checksum = 0u;
+				for (const auto& searchHit : searchHits)
+				{
+					const auto i = searchHit.movingIndex;
+					const auto b = blockStart(searchHit);
+					float leftBound, rightBound;
+					sweep_bounds(config, mColData.x[i], mColData.radius[i], leftBound, rightBound);
+
+					const auto block = collision_kernels::test_block<true>(&sColData.x[b], &sColData.y[b], &sColData.radius[b], mColData.x[i], mColData.y[i], mColData.radius[i], rightBound);
+					checksum += block.hits + (static_cast<uint64_t>(block.inBound) << 8);
+				}
+				return checksum;
+			}));
+
+			results.push_back(time_kernel("narrow_phase_scalar", options.repeats, searchHits.size(), [&]()
+			{
+				uint64_t checksum = 0u;
+				for (const auto& searchHit : searchHits)
+				{
+					const auto i = searchHit.movingIndex;
+					const auto b = blockStart(searchHit);
+					float leftBound, rightBound;
+					sweep_bounds(config, mColData.x[i], mColData.radius[i], leftBound, rightBound);
+
+					uint32_t hits = 0u, inBound = 0u;
+					for (auto lane = 0u; lane < collision_kernels::SWEEP_LANES; ++lane)
+					{
+						const auto s = b + lane;
+						if (sColData.x[s] < rightBound)
+						{
+							inBound |= 1u << lane;
+							if (collision_kernels::overlaps(sColData.x[s] - mColData.x[i], sColData.y[s] - mColData.y[i], sColData.radius[s] + mColData.radius[i]))
+							{
+								hits |= 1u << lane;
+							}
+						}
+					}
+					checksum += hits + (static_cast<uint64_t>(inBound) << 8);
+				}
+				return checksum;
+			}));
+		}
+
+		// Heatmap of every circle over all the threads, without writing the image. Same default size as _RASTERISE_FRAMES_
+		{
+			auto* stationaryHP = arena.allocate<std::atomic<int32_t>>(numStationary);
+			for (size_t i = 0u; i < numStationary; ++i)
+			{
+				new (&stationaryHP[i]) std::atomic<int32_t>(100);
+			}
+
+			thread_pool pool(options.threads - 1u);
+			density_raster raster(config.rasterWidth, config.rasterHeight, config.xSpawnRange, config.ySpawnRange, pool.num_threads());
+			results.push_back(time_kernel("density_raster", options.repeats, numStationary + numMoving, [&]()
+			{
+				raster.draw(pool, sColData, stationaryHP, mColData);
+
+				uint64_t checksum = raster.circles_drawn();
+				for (const auto channel : raster.pixels())
+				{
+					checksum += channel;
+				}
+				return checksum;
+			}));
+
+			// What _PUBLISH_FRAME_STATE_ adds to every frame. Stationary positions are only copied the first time
+			frame_publisher publisher(numStationary, numMoving);
+			uint32_t frame = 0u;
+			results.push_back(time_kernel("publish_frame_state", options.repeats, numStationary + numMoving, [&]()
+			{
+				publisher.publish(pool, ++frame, 1u, sColData, stationaryHP, mColData);
+				return static_cast<uint64_t>(numStationary + numMoving);
+			}));
+		}
+
+		// Last as it moves the circles. The positions live on in the arena so the stores can't be thrown away
+		results.push_back(time_kernel("integrate", options.repeats, numMoving, [&]()
+		{
+			collision_kernels::integrate(mColData.x, mColData.y, mColData.velocityX, mColData.velocityY, 0u, numMoving, 1.0f);
+			return static_cast<uint64_t>(numMoving);
+		}));
+
+		for (auto r = firstResult; r < results.size(); ++r)
+		{
+			results[r].circles = circles;
+			results[r].spawnHalfWidth = spawnHalfWidth;
+		}
+	}
+
+	// Cost of waking every worker and waiting for them all, with nothing to do in between
+	benchmark_result benchmark_dispatch(const benchmark_options& options)
+	{
+		const uint32_t RUNS = 1000u;
+
+		std::cerr << "Thread pool: " << options.threads << " threads\n";
+
+		thread_pool pool(options.threads - 1u);
+		std::vector<uint64_t> perThread(static_cast<size_t>(pool.num_threads()) * (CACHE_LINE_SIZE / sizeof(uint64_t)), 0u);
+
+		return time_kernel("dispatch_join", options.repeats, RUNS, [&]()
+		{
+			std::fill(perThread.begin(), perThread.end(), 0u);
+			for (auto run = 0u; run < RUNS; ++run)
+			{
+				pool.run([&](uint32_t threadIndex)
+				{
+					++perThread[threadIndex * (CACHE_LINE_SIZE / sizeof(uint64_t))];
+				});
+			}
+
+			// Every thread should have run every job
+			uint64_t total = 0u;
+			for (const auto count : perThread)
+			{
+				total += count;
+			}
+			return total;
+		});
+	}
+
+	std::string json_escape(const std::string& text)
+	{
+		std::string escaped;
+		for (const auto c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	void write_json(std::ostream& out, const benchmark_options& options, const std::vector<benchmark_result>& results)
+	{
+		out.precision(9);
+		out << "{\n";
+		out << "  \"benchmark\": \"kernel_benchmarks\",\n";
+		out << "  \"label\": \"" << json_escape(options.label) << "\",\n";
+		out << "  \"simd\": \"" << simd_name() << "\",\n";
+		out << "  \"seed\": " << options.seed << ",\n";
+		out << "  \"threads\": " << options.threads << ",\n";
+		out << "  \"repeats\": " << options.repeats << ",\n";
+		out << "  \"results\": [\n";
+
+		for (size_t r = 0u; r < results.size(); ++r)
+		{
+			const auto& result = results[r];
+
+			auto sorted = result.seconds;
+			std::sort(sorted.begin(), sorted.end());
+			const auto median = sorted[sorted.size() / 2];
+			double mean = 0.0;
+			for (const auto seconds : sorted)
+			{
+				mean += seconds;
+			}
+			mean /= static_cast<double>(sorted.size());
+
+			// Density is circles per unit area of the spawn range
+			const auto area = 4.0 * result.spawnHalfWidth * result.spawnHalfWidth;
+			const auto density = area > 0.0 ? result.circles / area : 0.0;
+
+			out << "    { \"kernel\": \"" << result.kernel << "\""
+				<< ", \"circles\": " << result.circles
+				<< ", \"spawn_half_width\": " << result.spawnHalfWidth
+				<< ", \"density\": " << density
+				<< ", \"items\": " << result.items
+				<< ", \"min_seconds\": " << sorted.front()
+				<< ", \"median_seconds\": " << median
+				<< ", \"mean_seconds\": " << mean
+				<< ", \"ns_per_item\": " << (result.items > 0u ? median * 1e9 / static_cast<double>(result.items) : 0.0)
+				<< ", \"checksum\": " << result.checksum
+				<< " }" << (r + 1u < results.size() ? "," : "") << '\n';
+		}
+
+		out << "  ]\n";
+		out << "}\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const auto options = parse_options(argc, argv);
+
+		std::vector<benchmark_result> results;
+		for (const auto circles : options.circles)
+		{
+			for (const auto spawnHalfWidth : options.spawnHalfWidths)
+			{
+				benchmark_scene(options, circles, spawnHalfWidth, results);
+			}
+		}
+		results.push_back(benchmark_dispatch(options));
+
+		if (options.outputPath.empty())
+		{
+			write_json(std::cout, options, results);
+		}
+		else
+		{
+			std::ofstream file(options.outputPath);
+			if (!file)
+			{
+				throw std::runtime_error("Could not open " + options.outputPath);
+			}
+			write_json(file, options, results);
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something went wrong! Msg: " << e.what();
+		return -1;
+	}
+
+	return 0;
+}
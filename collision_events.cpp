@@ -0,0 +1,126 @@
+#include "collision_events.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+collision_event_writer::collision_event_writer(uint32_t numThreads, const std::string& path, uint32_t numStationaryCircles, uint32_t numMovingCircles, uint32_t seed) : m_Path(path)
+{
+	for (auto i = 0u; i < numThreads; ++i)
+	{
+		m_Threads.push_back(std::make_unique<thread_chunks>());
+		m_Threads.back()->threadIndex = i;
+	}
+
+	m_File.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_File)
+	{
+		throw std::runtime_error("Could not open collision event file " + path);
+	}
+
+	event_file_header header;
+	std::memcpy(header.magic, EVENT_FILE_MAGIC, sizeof(header.magic));
+	header.headerSize = sizeof(event_file_header);
+	header.chunkHeaderSize = sizeof(event_chunk_header);
+	header.eventSize = sizeof(collision_event);
+	header.numStationaryCircles = numStationaryCircles;
+	header.numMovingCircles = numMovingCircles;
+	header.seed = seed;
+	m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	m_Writer = std::thread(&collision_event_writer::writer_loop, this);
+}
+
+collision_event_writer::~collision_event_writer()
+{
+	flush();
+	m_Stop.store(true);
+	m_Writer.join();
+}
+
+void collision_event_writer::flush()
+{
+	for (auto& thread : m_Threads)
+	{
+		if (thread->current != nullptr && thread->current->count != 0u)
+		{
+			submit_chunk(*thread);
+		}
+	}
+}
+
+collision_event_writer::event_chunk* collision_event_writer::take_chunk(thread_chunks& thread)
+{
+	event_chunk* chunk = nullptr;
+	while (thread.free.try_pop(&chunk, 1u) == 0u)
+	{
+		if (thread.owned.size() < MAX_CHUNKS_PER_THREAD)
+		{
+			thread.owned.push_back(std::make_unique<event_chunk>());
+			chunk = thread.owned.back().get();
+			break;
+		}
+
+		// Every chunk is waiting to be written. Wait rather than lose events
+		std::this_thread::yield();
+	}
+
+	chunk->threadIndex = thread.threadIndex;
+	chunk->count = 0u;
+	return chunk;
+}
+
+void collision_event_writer::submit_chunk(thread_chunks& thread)
+{
+	// Can't fail, the ring holds every chunk the thread owns
+	thread.full.try_push(thread.current);
+	thread.current = nullptr;
+}
+
+void collision_event_writer::writer_loop()
+{
+	while (true)
+	{
+		// Read the flag first so anything submitted before stop was asked for is written below
+		const bool stopping = m_Stop.load();
+
+		if (!write_chunks())
+		{
+			if (stopping)
+			{
+				m_File.flush();
+				return;
+			}
+
+			// Nothing to do. Sleep rather than spin on a core the workers could be using
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+}
+
+bool collision_event_writer::write_chunks()
+{
+	bool wrote = false;
+
+	for (auto& thread : m_Threads)
+	{
+		event_chunk* chunk;
+		while (thread->full.try_pop(&chunk, 1u) != 0u)
+		{
+			wrote = true;
+
+			event_chunk_header header;
+			header.eventCount = chunk->count;
+			header.threadIndex = chunk->threadIndex;
+			header.firstFrame = chunk->events[0].frame;
+			header.lastFrame = chunk->events[chunk->count - 1u].frame;
+
+			m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			m_File.write(reinterpret_cast<const char*>(chunk->events.data()), static_cast<std::streamsize>(chunk->count * sizeof(collision_event)));
+
+			thread->free.try_push(chunk);
+		}
+	}
+
+	return wrote;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libraries/spsc_ring.hpp"
+
+#pragma region FILE FORMAT
+// Binary collision event file written by _RECORD_COLLISION_EVENTS_
+//
+// [event_file_header] then any number of [event_chunk_header][eventCount x collision_event]
+// Everything is little endian, fixed size and 32 byte aligned, so a mapped file can be read in place
+// Each chunk holds the events of one thread in the order it found them. A chunk cut short by the program
+// being killed is simply ignored by readers
+
+constexpr char		EVENT_FILE_MAGIC[8] = { 'M', 'T', 'V', 'E', 'V', 'N', 'T', 'S' };
+// Version 2 names moving circles by id rather than by the slot they were in
+constexpr uint32_t	EVENT_FILE_VERSION = 2u;
+constexpr uint32_t	EVENT_CHUNK_MAGIC = 0x4B4E4843u; // "CHNK"
+
+struct event_file_header
+{
+	char		magic[8] = {};
+	uint32_t	version = EVENT_FILE_VERSION;
+	uint32_t	headerSize = 0u;
+	uint32_t	chunkHeaderSize = 0u;
+	uint32_t	eventSize = 0u;
+	// Scene the events came from
+	uint32_t	numStationaryCircles = 0u;
+	uint32_t	numMovingCircles = 0u;
+	uint32_t	seed = 0u;
+	uint32_t	reserved[7] = {};
+};
+
+struct event_chunk_header
+{
+	uint32_t	magic = EVENT_CHUNK_MAGIC;
+	uint32_t	eventCount = 0u;
+	uint32_t	threadIndex = 0u;
+	uint32_t	firstFrame = 0u;
+	uint32_t	lastFrame = 0u;
+	uint32_t	reserved[3] = {};
+};
+
+enum class collision_event_kind : uint16_t
+{
+	moving_stationary,
+	moving_moving,
+};
+
+struct collision_event
+{
+	uint32_t				frame = 0u;
+	// Moving circle id, the same circle in every frame
+	uint32_t				movingId = 0u;
+	// Stationary unique index, or the id of the second moving circle
+	uint32_t				otherId = 0u;
+	collision_event_kind	kind = collision_event_kind::moving_stationary;
+	uint16_t				reserved = 0u;
+	// Unit vector from the moving circle to the other circle
+	float					normalX = 0.0f;
+	float					normalY = 0.0f;
+	// HP after the hit
+	int32_t					movingHP = 0;
+	int32_t					otherHP = 0;
+};
+
+static_assert(sizeof(event_file_header) == 64, "Event file header layout changed");
+static_assert(sizeof(event_chunk_header) == 32, "Event chunk header layout changed");
+static_assert(sizeof(collision_event) == 32, "Collision event layout changed");
+
+#pragma endregion
+
+// Writes collision events to the file above without the recording threads ever waiting on disk
+// Each thread fills its own chunk and hands it to a writer thread when full, then carries on with a spare
+class collision_event_writer
+{
+public:
+	// Events per chunk. 64KB of events
+	static const uint32_t CHUNK_CAPACITY = 2048u;
+	// Chunks a thread can have in flight before it waits for the writer
+	static const uint32_t MAX_CHUNKS_PER_THREAD = 16u;
+
+	// Throws std::runtime_error if the file can't be created
+	collision_event_writer(uint32_t numThreads, const std::string& path, uint32_t numStationaryCircles, uint32_t numMovingCircles, uint32_t seed);
+
+	// Writes every chunk, including partly filled ones, then stops the writer. No thread may still be recording
+	~collision_event_writer();
+
+	collision_event_writer(const collision_event_writer&) = delete;
+	collision_event_writer& operator=(const collision_event_writer&) = delete;
+
+	// Only ever called by the thread that owns threadIndex
+	void record(uint32_t threadIndex, const collision_event& event)
+	{
+		auto& thread = *m_Threads[threadIndex];
+		if (thread.current == nullptr)
+		{
+			thread.current = take_chunk(thread);
+		}
+
+		auto& chunk = *thread.current;
+		chunk.events[chunk.count++] = event;
+		if (chunk.count == CHUNK_CAPACITY)
+		{
+			submit_chunk(thread);
+		}
+	}
+
+	// Hands every partly filled chunk to the writer so the file is complete up to now
+	// Only call while no thread is recording, e.g. between frames
+	void flush();
+
+	const std::string& path() const { return m_Path; }
+
+private:
+	struct event_chunk
+	{
+		uint32_t threadIndex = 0u;
+		uint32_t count = 0u;
+		std::array<collision_event, CHUNK_CAPACITY> events;
+	};
+
+	// Each thread has its own cache lines as they are written every event
+	struct alignas(64) thread_chunks
+	{
+		thread_chunks() : full(MAX_CHUNKS_PER_THREAD), free(MAX_CHUNKS_PER_THREAD) {}
+
+		event_chunk* current = nullptr;
+		// Thread -> writer
+		spsc_ring<event_chunk*> full;
+		// Writer -> thread, once written
+		spsc_ring<event_chunk*> free;
+		// Every chunk this thread has made. Only touched by the recording thread
+		std::vector<std::unique_ptr<event_chunk>> owned;
+		uint32_t threadIndex = 0u;
+	};
+
+	event_chunk* take_chunk(thread_chunks& thread);
+	void submit_chunk(thread_chunks& thread);
+
+	void writer_loop();
+	// Writes every full chunk waiting. False if there were none
+	bool write_chunks();
+
+	std::vector<std::unique_ptr<thread_chunks>> m_Threads;
+
+	std::string		m_Path;
+	std::ofstream	m_File;
+
+	std::atomic<bool>	m_Stop = { false };
+	std::thread			m_Writer;
+};
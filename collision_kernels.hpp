@@ -0,0 +1,764 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Pick the widest instruction set the compiler is targeting
+#if defined(__AVX2__)
+#define COLLISION_KERNEL_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLISION_KERNEL_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Kernels behind the collision phase. Kept free of the simulator so the kernel benchmarks can time exactly the same code
+// The narrow phase tests a block of SWEEP_LANES stationary circles against one moving circle using squared distances
+// Only the resulting bitmasks come back so the caller can handle the (rare) hit lanes in scalar code
+namespace collision_kernels
+{
+	constexpr uint32_t SWEEP_LANES = 8u;
+	constexpr uint32_t ALL_LANES = (1u << SWEEP_LANES) - 1u;
+
+	struct sweep_block
+	{
+		// Lanes still inside the sweep bound. Anything less than ALL_LANES means the sweep has ended in this block
+		uint32_t inBound = 0u;
+		// Lanes inside the bound that overlap the moving circle
+		uint32_t hits = 0u;
+	};
+
+	// Single circle test. Used for the tail of a sweep and by the grid
+	inline bool overlaps(float dx, float dy, float radiusSum)
+	{
+		return dx * dx + dy * dy < radiusSum * radiusSum;
+	}
+
+	inline uint32_t lowest_lane(uint32_t mask)
+	{
+	#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+	#else
+		return static_cast<uint32_t>(__builtin_ctz(mask));
+	#endif
+	}
+
+	inline uint32_t lane_count(uint32_t mask)
+	{
+		return static_cast<uint32_t>(std::bitset<SWEEP_LANES>(mask).count());
+	}
+
+	inline uint32_t highest_lane(uint32_t mask)
+	{
+	#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, mask);
+		return index;
+	#else
+		return 31u - static_cast<uint32_t>(__builtin_clz(mask));
+	#endif
+	}
+
+	// Tests x[0..8), y[0..8), radius[0..8) against a moving circle
+	// Sweeping right a lane is in bound while x < bound, sweeping left while x > bound
+	template <bool SweepRight>
+	inline sweep_block test_block(const float* x, const float* y, const float* radius, float mx, float my, float mRadius, float bound)
+	{
+		sweep_block block;
+
+	#if defined(COLLISION_KERNEL_AVX2)
+
+		const __m256 xs = _mm256_loadu_ps(x);
+		const __m256 dx = _mm256_sub_ps(xs, _mm256_set1_ps(mx));
+		const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y), _mm256_set1_ps(my));
+		const __m256 radiusSum = _mm256_add_ps(_mm256_loadu_ps(radius), _mm256_set1_ps(mRadius));
+
+		const __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		const __m256 overlap = _mm256_cmp_ps(distanceSq, _mm256_mul_ps(radiusSum, radiusSum), _CMP_LT_OQ);
+		const __m256 inBound = SweepRight ? _mm256_cmp_ps(xs, _mm256_set1_ps(bound), _CMP_LT_OQ) : _mm256_cmp_ps(xs, _mm256_set1_ps(bound), _CMP_GT_OQ);
+
+		block.inBound = static_cast<uint32_t>(_mm256_movemask_ps(inBound));
+		block.hits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_and_ps(overlap, inBound)));
+
+	#elif defined(COLLISION_KERNEL_SSE)
+
+		// Two halves of 4
+		const __m128 mxs = _mm_set1_ps(mx);
+		const __m128 mys = _mm_set1_ps(my);
+		const __m128 mRadiuses = _mm_set1_ps(mRadius);
+		const __m128 bounds = _mm_set1_ps(bound);
+
+		for (auto half = 0u; half < 2u; ++half)
+		{
+			const auto offset = half * 4u;
+
+			const __m128 xs = _mm_loadu_ps(x + offset);
+			const __m128 dx = _mm_sub_ps(xs, mxs);
+			const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + offset), mys);
+			const __m128 radiusSum = _mm_add_ps(_mm_loadu_ps(radius + offset), mRadiuses);
+
+			const __m128 distanceSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			const __m128 overlap = _mm_cmplt_ps(distanceSq, _mm_mul_ps(radiusSum, radiusSum));
+			const __m128 inBound = SweepRight ? _mm_cmplt_ps(xs, bounds) : _mm_cmpgt_ps(xs, bounds);
+
+			block.inBound |= static_cast<uint32_t>(_mm_movemask_ps(inBound)) << offset;
+			block.hits |= static_cast<uint32_t>(_mm_movemask_ps(_mm_and_ps(overlap, inBound))) << offset;
+		}
+
+	#else
+
+		for (auto lane = 0u; lane < SWEEP_LANES; ++lane)
+		{
+			const bool inBound = SweepRight ? x[lane] < bound : x[lane] > bound;
+			if (inBound)
+			{
+				block.inBound |= 1u << lane;
+				if (overlaps(x[lane] - mx, y[lane] - my, radius[lane] + mRadius))
+				{
+					block.hits |= 1u << lane;
+				}
+			}
+		}
+
+	#endif
+
+		return block;
+	}
+
+	// Moves circles first to first + count by their velocity for timeStep frames. Each axis streams its own position and velocity array
+	inline void integrate(float* x, float* y, const float* velocityX, const float* velocityY, size_t first, size_t count, float timeStep)
+	{
+		for (auto i = first; i < first + count; ++i)
+		{
+			x[i] += velocityX[i] * timeStep;
+			y[i] += velocityY[i] * timeStep;
+		}
+	}
+
+	// Binary search of x (sorted, count > 0) for any circle strictly between the bounds
+	// That circle is where the sweeps start from. False if there isn't one, so nothing can be hit
+	inline bool find_sweep_start(const float* x, size_t count, float leftBound, float rightBound, size_t& circleFound)
+	{
+		size_t s = 0u;
+		size_t e = count;
+		bool found = false;
+		do
+		{
+			circleFound = s + (e - s) / 2;
+
+			if (rightBound <= x[circleFound])
+			{
+				e = circleFound;
+			}
+			else if (leftBound >= x[circleFound])
+			{
+				s = circleFound;
+			}
+			else
+			{
+				found = true;
+			}
+		} while (!found && e - s > 1);
+
+		return found;
+	}
+
+	// find_sweep_start over a sorted array of count circles when only the part from first to first + partCount is held, in x
+	// Circles before the part count as left of any bound and circles after it as right of any bound. So as long as no
+	// circle outside the part is between the bounds, this takes the same steps and finds the same circle. circleFound is into x
+	inline bool find_sweep_start_in_part(const float* x, size_t first, size_t partCount, size_t count, float leftBound, float rightBound, size_t& circleFound)
+	{
+		size_t s = 0u;
+		size_t e = count;
+		do
+		{
+			const auto mid = s + (e - s) / 2;
+			const float midX = mid < first ? -INFINITY : (mid - first < partCount ? x[mid - first] : INFINITY);
+
+			if (rightBound <= midX)
+			{
+				e = mid;
+			}
+			else if (leftBound >= midX)
+			{
+				s = mid;
+			}
+			else
+			{
+				circleFound = mid - first;
+				return true;
+			}
+		} while (e - s > 1);
+
+		return false;
+	}
+
+	// Loads the cache line holding p so it's there by the time it's needed. Only a hint, nothing waits on it
+	inline void prefetch(const void* p)
+	{
+	#if defined(COLLISION_KERNEL_AVX2) || defined(COLLISION_KERNEL_SSE)
+		_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+	#elif defined(__GNUC__)
+		__builtin_prefetch(p);
+	#else
+		(void)p;
+	#endif
+	}
+
+	// Levels below a node whose descendants all share one cache line. 8 nodes a line, so the 8 great grandchildren
+	constexpr uint32_t SEARCH_PREFETCH_LEVELS = 3u;
+
+	// One midpoint of the search. The index comes with the key so finding a node needs nothing else loaded
+	struct search_node
+	{
+		float		x = INFINITY;
+		uint32_t	index = 0u;
+	};
+
+	// The midpoints find_sweep_start compares against, stored as a tree in breadth first (Eytzinger) order
+	// Node n has children 2n and 2n + 1 so the top levels share a few cache lines and a node's descendants a few levels
+	// down are next to each other and can be prefetched, rather than every step being a miss somewhere across the x array
+	// Descends the same tree as find_sweep_start so finds exactly the same start, which keeps collisions in the same order
+	// Midpoints don't make a complete tree, so gaps are padded with +infinity which is never between the bounds
+	struct sweep_search_index
+	{
+		// nodes[0] is unused. Come from the caller so they can live in an arena
+		search_node*	nodes = nullptr;
+		// Length of nodes. Always a power of 2
+		size_t			slots = 0u;
+
+		// Slots needed for count circles. Never more for fewer circles, so nodes can be rebuilt in place as circles are removed
+		static size_t slots_for(size_t count)
+		{
+			// The right half of a range is never smaller than the left so is always the deepest
+			size_t levels = 1u;
+			for (auto range = count; range - range / 2u > 1u; range -= range / 2u)
+			{
+				++levels;
+			}
+			return size_t(1u) << levels;
+		}
+
+		// x is sorted. nodeStorage must have room for slots_for(count)
+		void build(const float* x, size_t count, search_node* nodeStorage)
+		{
+			nodes = nodeStorage;
+			slots = slots_for(count);
+
+			std::fill(nodes, nodes + slots, search_node());
+			if (count != 0u)
+			{
+				build_node(x, 1u, 0u, count);
+			}
+		}
+
+		// Same answer as find_sweep_start(x, count, leftBound, rightBound, circleFound)
+		bool find(float leftBound, float rightBound, size_t& circleFound) const
+		{
+			size_t node = 1u;
+			while (node < slots)
+			{
+				// Near the bottom the descendants don't exist, so the last slot is fetched instead
+				prefetch(&nodes[std::min(node << SEARCH_PREFETCH_LEVELS, slots - 1u)]);
+
+				const float key = nodes[node].x;
+				if ((leftBound < key) & (key < rightBound))
+				{
+					circleFound = nodes[node].index;
+					return true;
+				}
+
+				// No branch to mispredict, the comparison picks the child
+				node = 2u * node + static_cast<size_t>(key < rightBound);
+			}
+			return false;
+		}
+
+	private:
+		// Node for the range s to e. Only ranges of more than one circle have children, as find_sweep_start stops there
+		void build_node(const float* x, size_t node, size_t s, size_t e)
+		{
+			const auto mid = s + (e - s) / 2;
+			nodes[node].x = x[mid];
+			nodes[node].index = static_cast<uint32_t>(mid);
+			if (mid - s > 1u)
+			{
+				build_node(x, 2u * node, s, mid);
+			}
+			if (e - mid > 1u)
+			{
+				build_node(x, 2u * node + 1u, mid, e);
+			}
+		}
+	};
+
+	// Earliest fraction t in [0, 1] of the motion (dx, dy) at which a circle starting at (px, py) touches a circle at (cx, cy)
+	// A circle already overlapping only hits if it is moving further in, so it isn't hit again every frame on the way out
+	// False if they never touch during the motion
+	inline bool time_of_impact(float px, float py, float dx, float dy, float cx, float cy, float radiusSum, float& t)
+	{
+		// Solves |p + t * d - c| = radiusSum as a quadratic in t
+		const float fx = px - cx;
+		const float fy = py - cy;
+		const float halfB = fx * dx + fy * dy;
+		const float c = fx * fx + fy * fy - radiusSum * radiusSum;
+
+		// Moving apart, or not moving
+		if (halfB >= 0.0f)
+		{
+			return false;
+		}
+		if (c <= 0.0f)
+		{
+			t = 0.0f;
+			return true;
+		}
+
+		const float a = dx * dx + dy * dy;
+		const float discriminant = halfB * halfB - a * c;
+		if (discriminant < 0.0f)
+		{
+			return false;
+		}
+
+		t = (-halfB - std::sqrt(discriminant)) / a;
+		return t <= 1.0f;
+	}
+
+	// True if a circle offset (fx, fy) from the other circle comes within radiusSum of it while moving by (dx, dy) towards it
+	// Same answer as time_of_impact without the square root. Closest approach is at t = -(f.d) / |d|^2, clamped to the motion
+	inline bool touches_along(float fx, float fy, float dx, float dy, float invLengthSq, float radiusSum)
+	{
+		const float halfB = fx * dx + fy * dy;
+		const float t = std::min(std::max(-halfB * invLengthSq, 0.0f), 1.0f);
+		const float ex = fx + t * dx;
+		const float ey = fy + t * dy;
+		return halfB < 0.0f && ex * ex + ey * ey <= radiusSum * radiusSum;
+	}
+
+	// Swept test_block. Lanes hit if touches_along is true for them
+	template <bool SweepRight>
+	inline sweep_block test_swept_block(const float* x, const float* y, const float* radius, float px, float py, float dx, float dy, float invLengthSq, float mRadius, float bound)
+	{
+		sweep_block block;
+
+	#if defined(COLLISION_KERNEL_AVX2)
+
+		const __m256 xs = _mm256_loadu_ps(x);
+		const __m256 fx = _mm256_sub_ps(_mm256_set1_ps(px), xs);
+		const __m256 fy = _mm256_sub_ps(_mm256_set1_ps(py), _mm256_loadu_ps(y));
+		const __m256 dxs = _mm256_set1_ps(dx);
+		const __m256 dys = _mm256_set1_ps(dy);
+		const __m256 radiusSum = _mm256_add_ps(_mm256_loadu_ps(radius), _mm256_set1_ps(mRadius));
+
+		const __m256 halfB = _mm256_add_ps(_mm256_mul_ps(fx, dxs), _mm256_mul_ps(fy, dys));
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 t = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(zero, halfB), _mm256_set1_ps(invLengthSq)), zero), _mm256_set1_ps(1.0f));
+		const __m256 ex = _mm256_add_ps(fx, _mm256_mul_ps(t, dxs));
+		const __m256 ey = _mm256_add_ps(fy, _mm256_mul_ps(t, dys));
+
+		const __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey));
+		const __m256 touches = _mm256_and_ps(_mm256_cmp_ps(distanceSq, _mm256_mul_ps(radiusSum, radiusSum), _CMP_LE_OQ), _mm256_cmp_ps(halfB, zero, _CMP_LT_OQ));
+		const __m256 inBound = SweepRight ? _mm256_cmp_ps(xs, _mm256_set1_ps(bound), _CMP_LT_OQ) : _mm256_cmp_ps(xs, _mm256_set1_ps(bound), _CMP_GT_OQ);
+
+		block.inBound = static_cast<uint32_t>(_mm256_movemask_ps(inBound));
+		block.hits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_and_ps(touches, inBound)));
+
+	#elif defined(COLLISION_KERNEL_SSE)
+
+		// Two halves of 4
+		const __m128 pxs = _mm_set1_ps(px);
+		const __m128 pys = _mm_set1_ps(py);
+		const __m128 dxs = _mm_set1_ps(dx);
+		const __m128 dys = _mm_set1_ps(dy);
+		const __m128 invLengthSqs = _mm_set1_ps(invLengthSq);
+		const __m128 mRadiuses = _mm_set1_ps(mRadius);
+		const __m128 bounds = _mm_set1_ps(bound);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		for (auto half = 0u; half < 2u; ++half)
+		{
+			const auto offset = half * 4u;
+
+			const __m128 xs = _mm_loadu_ps(x + offset);
+			const __m128 fx = _mm_sub_ps(pxs, xs);
+			const __m128 fy = _mm_sub_ps(pys, _mm_loadu_ps(y + offset));
+			const __m128 radiusSum = _mm_add_ps(_mm_loadu_ps(radius + offset), mRadiuses);
+
+			const __m128 halfB = _mm_add_ps(_mm_mul_ps(fx, dxs), _mm_mul_ps(fy, dys));
+			const __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(zero, halfB), invLengthSqs), zero), one);
+			const __m128 ex = _mm_add_ps(fx, _mm_mul_ps(t, dxs));
+			const __m128 ey = _mm_add_ps(fy, _mm_mul_ps(t, dys));
+
+			const __m128 distanceSq = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+			const __m128 touches = _mm_and_ps(_mm_cmple_ps(distanceSq, _mm_mul_ps(radiusSum, radiusSum)), _mm_cmplt_ps(halfB, zero));
+			const __m128 inBound = SweepRight ? _mm_cmplt_ps(xs, bounds) : _mm_cmpgt_ps(xs, bounds);
+
+			block.inBound |= static_cast<uint32_t>(_mm_movemask_ps(inBound)) << offset;
+			block.hits |= static_cast<uint32_t>(_mm_movemask_ps(_mm_and_ps(touches, inBound))) << offset;
+		}
+
+	#else
+
+		for (auto lane = 0u; lane < SWEEP_LANES; ++lane)
+		{
+			const bool inBound = SweepRight ? x[lane] < bound : x[lane] > bound;
+			if (inBound)
+			{
+				block.inBound |= 1u << lane;
+				if (touches_along(px - x[lane], py - y[lane], dx, dy, invLengthSq, radius[lane] + mRadius))
+				{
+					block.hits |= 1u << lane;
+				}
+			}
+		}
+
+	#endif
+
+		return block;
+	}
+
+	// Walks right from start while x < rightBound, calling onHit(index) in ascending order for every circle that passes the test
+	// blockTest(first) tests SWEEP_LANES circles from first at once, singleTest(index) tests one for the tail of the array
+	// Returns how many circles were inside the bound and so were tested
+	template <typename BlockTest, typename SingleTest, typename OnHit>
+	inline size_t walk_right(const float* x, size_t count, size_t start, float rightBound, BlockTest&& blockTest, SingleTest&& singleTest, OnHit&& onHit)
+	{
+		auto stationaryToStart = start;
+		size_t candidates = 0u;
+		while (stationaryToStart + SWEEP_LANES <= count)
+		{
+			const sweep_block block = blockTest(stationaryToStart);
+			candidates += lane_count(block.inBound);
+
+			// Ascending lanes keeps the same order as walking one at a time
+			for (auto hits = block.hits; hits != 0u; hits &= hits - 1u)
+			{
+				onHit(stationaryToStart + lowest_lane(hits));
+			}
+
+			if (block.inBound != ALL_LANES)
+			{
+				return candidates;
+			}
+			stationaryToStart += SWEEP_LANES;
+		}
+
+		// Less than a block left at the end of the array
+		while (stationaryToStart != count && rightBound > x[stationaryToStart])
+		{
+			if (singleTest(stationaryToStart))
+			{
+				onHit(stationaryToStart);
+			}
+
+			++candidates;
+			++stationaryToStart;
+		}
+		return candidates;
+	}
+
+	// Walks left from start - 1 while x > leftBound, calling onHit(index) in descending order for every circle that passes the test
+	// blockTest(first) tests SWEEP_LANES circles from first at once. Returns how many circles were inside the bound
+	template <typename BlockTest, typename SingleTest, typename OnHit>
+	inline size_t walk_left(const float* x, size_t start, float leftBound, BlockTest&& blockTest, SingleTest&& singleTest, OnHit&& onHit)
+	{
+		// Blocks end just before stationaryToStart
+		auto stationaryToStart = start;
+		size_t candidates = 0u;
+		while (stationaryToStart >= SWEEP_LANES)
+		{
+			const auto blockStart = stationaryToStart - SWEEP_LANES;
+			const sweep_block block = blockTest(blockStart);
+			candidates += lane_count(block.inBound);
+
+			// Descending lanes as this sweep walks backwards
+			for (auto hits = block.hits; hits != 0u;)
+			{
+				const auto lane = highest_lane(hits);
+				hits &= ~(1u << lane);
+
+				onHit(blockStart + lane);
+			}
+
+			if (block.inBound != ALL_LANES)
+			{
+				return candidates;
+			}
+			stationaryToStart = blockStart;
+		}
+
+		// Less than a block left at the start of the array
+		while (stationaryToStart-- != 0u && leftBound < x[stationaryToStart])
+		{
+			if (singleTest(stationaryToStart))
+			{
+				onHit(stationaryToStart);
+			}
+
+			++candidates;
+		}
+		return candidates;
+	}
+
+	// Walks right from start while x < rightBound, calling onHit(index) in ascending order for every overlap
+	// Full blocks go through the vector kernel, only the lanes that hit come back to scalar code
+	// Returns how many circles were inside the bound and so went through the narrow phase
+	template <typename OnHit>
+	inline size_t sweep_right(const float* x, const float* y, const float* radius, size_t count, size_t start, float mx, float my, float mRadius, float rightBound, OnHit&& onHit)
+	{
+		return walk_right(x, count, start, rightBound,
+			[&](size_t first) { return test_block<true>(&x[first], &y[first], &radius[first], mx, my, mRadius, rightBound); },
+			[&](size_t i) { return overlaps(x[i] - mx, y[i] - my, mRadius + radius[i]); },
+			onHit);
+	}
+
+	// Walks left from start - 1 while x > leftBound, calling onHit(index) in descending order for every overlap
+	// Returns how many circles were inside the bound
+	template <typename OnHit>
+	inline size_t sweep_left(const float* x, const float* y, const float* radius, size_t start, float mx, float my, float mRadius, float leftBound, OnHit&& onHit)
+	{
+		return walk_left(x, start, leftBound,
+			[&](size_t first) { return test_block<false>(&x[first], &y[first], &radius[first], mx, my, mRadius, leftBound); },
+			[&](size_t i) { return overlaps(x[i] - mx, y[i] - my, mRadius + radius[i]); },
+			onHit);
+	}
+
+	// Most candidates the quantized sweeps collect before testing them exactly
+	constexpr size_t QUANTIZED_CANDIDATE_BATCH = 32u;
+
+	// Positions as 16 bit fixed point, x in the high half of a uint32_t and y in the low half
+	// Units are 1 / scale from the middle of the range, so positions inside the range are within half a unit on each axis
+	// Positions outside are clamped to the edge, which only ever brings them closer to anything inside
+	struct position_quantizer
+	{
+		float originX = 0.0f;
+		float originY = 0.0f;
+		float scale = 1.0f;
+
+		static position_quantizer for_range(float minX, float maxX, float minY, float maxY)
+		{
+			position_quantizer quantizer;
+			quantizer.originX = 0.5f * (minX + maxX);
+			quantizer.originY = 0.5f * (minY + maxY);
+			// A little under 2^16 units across so nothing inside the range is clamped
+			quantizer.scale = 65000.0f / std::max(std::max(maxX - minX, maxY - minY), 1e-3f);
+			return quantizer;
+		}
+
+		// Nearest unit. Never decreases as the position increases so sorted x stays sorted
+		// Stops one short of the 16 bit limits so a sweep bound one past any position still fits
+		int32_t fixed_x(float x) const { return to_fixed((x - originX) * scale); }
+		int32_t fixed_y(float y) const { return to_fixed((y - originY) * scale); }
+
+		uint32_t pack(float x, float y) const
+		{
+			return (static_cast<uint32_t>(static_cast<uint16_t>(fixed_x(x))) << 16) | static_cast<uint16_t>(fixed_y(y));
+		}
+
+		// Squared distance in units that can't be missed by circles within distance of each other, given both were rounded
+		// Clamped to what a 32 bit lane can hold, by which point everything is in reach anyway
+		int32_t reach_squared(float distance) const
+		{
+			// Rounding moves each position up to half a unit on each axis, the rest covers float error
+			const double reach = static_cast<double>(distance) * scale + 1.5;
+			return static_cast<int32_t>(std::min(reach * reach, 2147483647.0));
+		}
+
+	private:
+		static int32_t to_fixed(float units)
+		{
+			// Rounds half away from zero, like lround without the library call
+			const float clamped = std::min(std::max(units, -32766.0f), 32766.0f);
+			return static_cast<int32_t>(clamped >= 0.0f ? clamped + 0.5f : clamped - 0.5f);
+		}
+	};
+
+	// test_block on packed positions against a packed moving position. Lanes hit if their squared distance in units is <= reachSquared
+	// Sweeping right a lane is in bound while its fixed x < bound, sweeping left while it is > bound
+	// Stays in 16 bit integers. Differences saturate rather than wrap, which can only make a lane look closer
+	template <bool SweepRight>
+	inline sweep_block test_quantized_block(const uint32_t* packed, uint32_t mPacked, int32_t reachSquared, int16_t bound)
+	{
+		sweep_block block;
+
+	#if defined(COLLISION_KERNEL_AVX2)
+
+		const __m256i positions = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packed));
+		const __m256i difference = _mm256_subs_epi16(positions, _mm256_set1_epi32(static_cast<int32_t>(mPacked)));
+		// dx * dx + dy * dy in each 32 bit lane
+		const __m256i distanceSq = _mm256_madd_epi16(difference, difference);
+		const __m256i inReach = _mm256_xor_si256(_mm256_cmpgt_epi32(distanceSq, _mm256_set1_epi32(reachSquared)), _mm256_set1_epi32(-1));
+
+		// Compares both halves but x is in the high one, which is the only bit movemask takes
+		const __m256i bounds = _mm256_set1_epi16(bound);
+		const __m256i inBound = SweepRight ? _mm256_cmpgt_epi16(bounds, positions) : _mm256_cmpgt_epi16(positions, bounds);
+
+		block.inBound = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(inBound)));
+		block.hits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(inReach, inBound))));
+
+	#elif defined(COLLISION_KERNEL_SSE)
+
+		// Two halves of 4
+		const __m128i mPositions = _mm_set1_epi32(static_cast<int32_t>(mPacked));
+		const __m128i reach = _mm_set1_epi32(reachSquared);
+		const __m128i bounds = _mm_set1_epi16(bound);
+
+		for (auto half = 0u; half < 2u; ++half)
+		{
+			const auto offset = half * 4u;
+
+			const __m128i positions = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed + offset));
+			const __m128i difference = _mm_subs_epi16(positions, mPositions);
+			const __m128i distanceSq = _mm_madd_epi16(difference, difference);
+			const __m128i inReach = _mm_xor_si128(_mm_cmpgt_epi32(distanceSq, reach), _mm_set1_epi32(-1));
+			const __m128i inBound = SweepRight ? _mm_cmpgt_epi16(bounds, positions) : _mm_cmpgt_epi16(positions, bounds);
+
+			block.inBound |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(inBound))) << offset;
+			block.hits |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(inReach, inBound)))) << offset;
+		}
+
+	#else
+
+		const int32_t mFixedX = static_cast<int16_t>(mPacked >> 16);
+		const int32_t mFixedY = static_cast<int16_t>(mPacked & 0xFFFFu);
+		for (auto lane = 0u; lane < SWEEP_LANES; ++lane)
+		{
+			const int32_t fixedX = static_cast<int16_t>(packed[lane] >> 16);
+			const int32_t fixedY = static_cast<int16_t>(packed[lane] & 0xFFFFu);
+			const bool inBound = SweepRight ? fixedX < bound : fixedX > bound;
+			if (inBound)
+			{
+				block.inBound |= 1u << lane;
+				const int64_t dx = fixedX - mFixedX;
+				const int64_t dy = fixedY - mFixedY;
+				if (dx * dx + dy * dy <= reachSquared)
+				{
+					block.hits |= 1u << lane;
+				}
+			}
+		}
+
+	#endif
+
+		return block;
+	}
+
+	// sweep_right that streams 4 byte packed positions instead of 12 bytes of x, y and radius
+	// Blocks are tested in fixed point with the reach widened to cover the rounding, only lanes that pass are tested
+	// exactly with the floats. Hits are the same as sweep_right. maxRadius is the largest stationary radius
+	template <typename OnHit>
+	inline size_t sweep_right_quantized(const float* x, const float* y, const float* radius, const uint32_t* packed, const position_quantizer& quantizer,
+		size_t count, size_t start, float mx, float my, float mRadius, float maxRadius, float rightBound, OnHit&& onHit)
+	{
+		const auto mPacked = quantizer.pack(mx, my);
+		const auto reachSquared = quantizer.reach_squared(mRadius + maxRadius);
+		const auto bound = static_cast<int16_t>(quantizer.fixed_x(rightBound) + 1);
+
+		// Every candidate that gets through the fixed point test or is in the tail ends up here
+		// Candidates are collected then tested together, so the float loads for each are in flight at the same time
+		// rather than each one stalling the walk
+		size_t candidates[QUANTIZED_CANDIDATE_BATCH];
+		size_t numCandidates = 0u;
+		const auto testCandidates = [&]()
+		{
+			for (size_t c = 0; c < numCandidates; ++c)
+			{
+				const auto i = candidates[c];
+				if ((x[i] < rightBound) & overlaps(x[i] - mx, y[i] - my, mRadius + radius[i]))
+				{
+					onHit(i);
+				}
+			}
+			numCandidates = 0u;
+		};
+		const auto onCandidate = [&](size_t i)
+		{
+			candidates[numCandidates++] = i;
+			if (numCandidates == QUANTIZED_CANDIDATE_BATCH)
+			{
+				testCandidates();
+			}
+		};
+
+		const auto tested = walk_right(x, count, start, rightBound,
+			[&](size_t first) { return test_quantized_block<true>(&packed[first], mPacked, reachSquared, bound); },
+			[](size_t) { return true; },
+			onCandidate);
+		testCandidates();
+		return tested;
+	}
+
+	template <typename OnHit>
+	inline size_t sweep_left_quantized(const float* x, const float* y, const float* radius, const uint32_t* packed, const position_quantizer& quantizer,
+		size_t start, float mx, float my, float mRadius, float maxRadius, float leftBound, OnHit&& onHit)
+	{
+		const auto mPacked = quantizer.pack(mx, my);
+		const auto reachSquared = quantizer.reach_squared(mRadius + maxRadius);
+		const auto bound = static_cast<int16_t>(quantizer.fixed_x(leftBound) - 1);
+
+		// Candidates are collected then tested together, so the float loads for each are in flight at the same time
+		// rather than each one stalling the walk
+		size_t candidates[QUANTIZED_CANDIDATE_BATCH];
+		size_t numCandidates = 0u;
+		const auto testCandidates = [&]()
+		{
+			for (size_t c = 0; c < numCandidates; ++c)
+			{
+				const auto i = candidates[c];
+				if ((x[i] > leftBound) & overlaps(x[i] - mx, y[i] - my, mRadius + radius[i]))
+				{
+					onHit(i);
+				}
+			}
+			numCandidates = 0u;
+		};
+		const auto onCandidate = [&](size_t i)
+		{
+			candidates[numCandidates++] = i;
+			if (numCandidates == QUANTIZED_CANDIDATE_BATCH)
+			{
+				testCandidates();
+			}
+		};
+
+		const auto tested = walk_left(x, start, leftBound,
+			[&](size_t first) { return test_quantized_block<false>(&packed[first], mPacked, reachSquared, bound); },
+			[](size_t) { return true; },
+			onCandidate);
+		testCandidates();
+		return tested;
+	}
+
+	// Swept versions of the above for a moving circle travelling from (px, py) by (dx, dy), which must not be zero
+	// onHit(index) is called for every circle the motion touches, which is when time_of_impact will find a contact
+	template <typename OnHit>
+	inline size_t swept_right(const float* x, const float* y, const float* radius, size_t count, size_t start, float px, float py, float dx, float dy, float mRadius, float rightBound, OnHit&& onHit)
+	{
+		const float invLengthSq = 1.0f / (dx * dx + dy * dy);
+		return walk_right(x, count, start, rightBound,
+			[&](size_t first) { return test_swept_block<true>(&x[first], &y[first], &radius[first], px, py, dx, dy, invLengthSq, mRadius, rightBound); },
+			[&](size_t i) { return touches_along(px - x[i], py - y[i], dx, dy, invLengthSq, mRadius + radius[i]); },
+			onHit);
+	}
+
+	template <typename OnHit>
+	inline size_t swept_left(const float* x, const float* y, const float* radius, size_t start, float px, float py, float dx, float dy, float mRadius, float leftBound, OnHit&& onHit)
+	{
+		const float invLengthSq = 1.0f / (dx * dx + dy * dy);
+		return walk_left(x, start, leftBound,
+			[&](size_t first) { return test_swept_block<false>(&x[first], &y[first], &radius[first], px, py, dx, dy, invLengthSq, mRadius, leftBound); },
+			[&](size_t i) { return touches_along(px - x[i], py - y[i], dx, dy, invLengthSq, mRadius + radius[i]); },
+			onHit);
+	}
+}
@@ -0,0 +1,139 @@
+#include "collision_log.hpp"
+
+#include "libraries/threadstream.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	// Lines are written in batches of about this many bytes
+	constexpr size_t WRITE_BATCH_SIZE = 1u << 16;
+
+	// Records taken from a queue at a time
+	constexpr size_t DRAIN_BATCH_SIZE = 256u;
+
+	void append_int(std::string& buffer, int64_t value)
+	{
+		char digits[24];
+		const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+		buffer.append(digits, result.ptr);
+	}
+}
+
+collision_log::collision_log(uint32_t numThreads, size_t recordsPerThread, const std::string& path) : m_Path(path)
+{
+	for (auto i = 0u; i < numThreads; ++i)
+	{
+		m_Queues.push_back(std::make_unique<spsc_ring<collision_log_record>>(recordsPerThread));
+	}
+
+	if (path.empty())
+	{
+		m_Output = &std::cout;
+	}
+	else
+	{
+		m_File.open(path);
+		if (!m_File)
+		{
+			throw std::runtime_error("Could not open collision log " + path);
+		}
+		m_Output = &m_File;
+	}
+
+	m_Buffer.reserve(WRITE_BATCH_SIZE * 2u);
+	m_Writer = std::thread(&collision_log::writer_loop, this);
+}
+
+collision_log::~collision_log()
+{
+	m_Stop.store(true);
+	m_Writer.join();
+}
+
+void collision_log::writer_loop()
+{
+	while (true)
+	{
+		// Read the flag first so anything pushed before stop was asked for is drained below
+		const bool stopping = m_Stop.load();
+
+		if (!drain_queues())
+		{
+			write_buffer();
+			if (stopping)
+			{
+				return;
+			}
+
+			// Nothing to do. Sleep rather than spin on a core the workers could be using
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+}
+
+bool collision_log::drain_queues()
+{
+	collision_log_record records[DRAIN_BATCH_SIZE];
+	bool drained = false;
+
+	for (auto& queue : m_Queues)
+	{
+		size_t count;
+		while ((count = queue->try_pop(records, DRAIN_BATCH_SIZE)) != 0u)
+		{
+			drained = true;
+			for (size_t i = 0u; i < count; ++i)
+			{
+				format(records[i]);
+			}
+
+			if (m_Buffer.size() >= WRITE_BATCH_SIZE)
+			{
+				write_buffer();
+			}
+		}
+	}
+
+	return drained;
+}
+
+void collision_log::format(const collision_log_record& record)
+{
+	// Same line TOUT used to print, with the frame in front as threads are no longer in step with the frame output
+	// e.g. [12] M5 HP: 80 hit S7 HP: 60
+	m_Buffer += '[';
+	append_int(m_Buffer, record.frame);
+	m_Buffer += "] M";
+	append_int(m_Buffer, record.a);
+	m_Buffer += " HP: ";
+	append_int(m_Buffer, record.aHP);
+	m_Buffer += record.bIsMoving ? " hit M" : " hit S";
+	append_int(m_Buffer, record.b);
+	m_Buffer += " HP: ";
+	append_int(m_Buffer, record.bHP);
+	m_Buffer += '\n';
+}
+
+void collision_log::write_buffer()
+{
+	if (m_Buffer.empty())
+	{
+		return;
+	}
+
+	// Whole lines in one write, under the same lock as TOUT so they don't tear against the frame output on stdout
+	{
+		std::unique_lock<std::mutex> lock(ThreadStream::mutex(), std::defer_lock);
+		if (m_Output == &std::cout)
+		{
+			lock.lock();
+		}
+		m_Output->write(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()));
+		m_Output->flush();
+	}
+	m_Buffer.clear();
+}
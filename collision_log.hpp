@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libraries/spsc_ring.hpp"
+
+// One collision as logged by _OUTPUT_ALL_. Fixed size so threads only ever copy a few words
+struct collision_log_record
+{
+	uint32_t	frame = 0u;
+	// Moving circle id
+	uint32_t	a = 0u;
+	// Stationary unique index, or moving id when bIsMoving
+	uint32_t	b = 0u;
+	int32_t		aHP = 0;
+	int32_t		bHP = 0;
+	bool		bIsMoving = false;
+};
+
+// Collision log with a lock-free queue per thread and a background thread that formats and writes the lines
+// Threads never wait on each other, only on the writer when their own queue is full
+class collision_log
+{
+public:
+	// One queue per thread. Empty path writes to stdout. Throws std::runtime_error if the file can't be opened
+	collision_log(uint32_t numThreads, size_t recordsPerThread, const std::string& path);
+
+	// Writes anything left then stops the writer thread
+	~collision_log();
+
+	collision_log(const collision_log&) = delete;
+	collision_log& operator=(const collision_log&) = delete;
+
+	// Only ever called by the thread that owns threadIndex
+	void log(uint32_t threadIndex, const collision_log_record& record)
+	{
+		auto& queue = *m_Queues[threadIndex];
+		while (!queue.try_push(record))
+		{
+			// Writer has fallen behind. Wait rather than lose lines
+			std::this_thread::yield();
+		}
+	}
+
+	const std::string& path() const { return m_Path; }
+
+private:
+	void writer_loop();
+	// Takes everything currently queued and formats it into m_Buffer. False if there was nothing
+	bool drain_queues();
+	void format(const collision_log_record& record);
+	void write_buffer();
+
+	std::vector<std::unique_ptr<spsc_ring<collision_log_record>>> m_Queues;
+
+	std::string		m_Path;
+	std::ofstream	m_File;
+	std::ostream*	m_Output = nullptr;
+
+	// Only touched by the writer thread
+	std::string		m_Buffer;
+
+	std::atomic<bool>	m_Stop = { false };
+	std::thread			m_Writer;
+};
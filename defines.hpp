@@ -1,18 +1,22 @@
 #pragma once
 
-#include <random>
-#include <condition_variable>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <string>
-#include <thread>
+#include <vector>
 
 #include <Eigen/Core>
 using Eigen::Vector2f;
 using Eigen::Vector3f;
 
+#include "libraries/aligned_arena.hpp"
+
 #pragma region MACROS
 
-// Will output result of each collision
-// Note will mess with _TIME_LOOPS_ - Results will not be accurate
+// Will output result of each collision, to stdout or the log_file option
+// Each thread queues fixed size records without locking and a background thread writes them out
+// Note the writer still competes for cores and threads wait on it if their queue fills, so _TIME_LOOPS_ will be slower
 //#define _OUTPUT_ALL_ 
 
 // Will output time to complete each loop
@@ -21,6 +25,23 @@ using Eigen::Vector3f;
 // Will track how many collisions each frame
 #define _TRACK_COLLISIONS_
 
+// Will output how long each thread was busy each frame
+// Shows how well the work is balanced between threads
+// #define _TIME_THREADS_
+
+// Will write how each thread spent every phase of every frame to a file (stats_file option, thread_stats.csv by default)
+// Records wake latency, compute time, time idle at the barrier, narrow phase candidates and hits per thread
+// Ending the file name in .json writes a Chrome trace instead of CSV
+// #define _EXPORT_THREAD_STATS_
+
+// Will time nested zones of each frame (integrate, search, sweep, resolve, dispatch, join...) on every thread and output them as a tree
+// Threads add up their own totals, so nothing waits on anything. Costs one to three clock reads per moving circle, frames at 1M circles are around 5-10% slower
+// #define _PROFILE_ZONES_
+
+// Will write every collision as a compact binary record to a file (events_file option, collisions.events by default)
+// Records are chunked per thread and written by a background thread. Read them back with tools/event_reader
+// #define _RECORD_COLLISION_EVENTS_
+
 // Will pause after each "frame" i.e. each time all circles processed
 // Note will mess with _TIME_LOOPS_ - Results will not be accurate
 // #define _PAUSE_AFTER_EACH_FRAME_
@@ -32,40 +53,115 @@ using Eigen::Vector3f;
 // 100k seems to be the upper limit with my PC (Ryzen 5 1600 AF, RTX 2070)
 // #define _USE_TL_ENGINE_
 
+// Will draw every circle into a heatmap image every raster_every frames and write it as raster_file_<frame>.ppm
+// Headless and drawn over the thread pool, so unlike _USE_TL_ENGINE_ it keeps up with millions of circles. Brightness is
+// how many circles are in a pixel, green to red is their average HP. Drawing and writing the image is counted in the frame time
+// #define _RASTERISE_FRAMES_
+
+// Will copy the position and HP of every circle at the end of each frame for consumers running on a thread of their own
+// Copies are triple buffered so the simulation never waits, and consumers that fall behind skip to the latest frame
+// With _RASTERISE_FRAMES_ the heatmap is drawn by a consumer, so the frame only pays for the copy however long drawing takes
+// #define _PUBLISH_FRAME_STATE_
+
 // will randomise radiuses of circles
 // Increases collision a lot
 // #define _RANDOM_RADIUS_
 
+// Will bucket stationary circles into a uniform 2D grid instead of using the x-axis line sweep
+// Each moving circle then only tests the 3x3 cells around it rather than a whole x-slab of the spawn range
+// Median frame at 2M circles on one thread: 0.29s against 1.42s for the sweep, and 2.81s against 6.37s with _RANDOM_RADIUS_
+// #define _USE_SPATIAL_GRID_
+
+// Will keep a 16-bit fixed point copy of the stationary positions for the line sweep
+// The sweep streams 4 bytes per candidate instead of 12 and only reads the floats for circles that are close
+// Collisions are exactly the same as without it
+// #define _QUANTIZED_POSITIONS_
+
+// Will find where each line sweep starts with a copy of the binary search tree laid out breadth first (Eytzinger order)
+// The first levels share a few cache lines and each step prefetches the levels below, instead of each step missing across the x array
+// Finds exactly the same start as the plain binary search. Costs 8-16 bytes per stationary circle. No effect with _USE_SPATIAL_GRID_
+// #define _EYTZINGER_SEARCH_
+
+// Will sweep each moving circle along its motion for the frame and stop it at the first stationary circle it touches
+// Circles can no longer tunnel through each other so the time_step option can be raised to run fewer, bigger frames
+// Always uses the line sweep for stationary circles, even with _USE_SPATIAL_GRID_. Moving vs moving is still tested at the end of the frame
+// #define _SWEPT_COLLISIONS_
+
+// Will remove circles once their HP reaches 0, so the work each frame shrinks as circles are destroyed
+// Stationary circles are shifted out of the sorted arrays, moving circles have their slots filled from the end of the array
+// Moving circles change slots when that happens, so logs and event files name them by an id that stays with each circle
+// #define _REMOVE_DESTROYED_CIRCLES_
+
+// Will also collide moving circles with each other
+// Moving circles are radix sorted by x across all threads each frame then line swept for pairs
+// #define _MOVING_COLLISIONS_
+
+// Will split the spawn area into x-slabs and simulate each in its own process (ranks option, 2 by default)
+// Ranks share stationary HP through shared memory and hand moving circles to their neighbour when they cross a slab edge
+// Each rank only generates the stationary circles within touching distance of its slab, which never change, so
+// collisions come out the same as a single process. Only the first rank prints. POSIX only
+// Only the x-axis line sweep against stationary circles is supported, so it can't be combined with the options checked below
+// #define _MULTI_PROCESS_
+
+#if defined(_MULTI_PROCESS_) && (defined(_USE_TL_ENGINE_) || defined(_RASTERISE_FRAMES_) || defined(_PUBLISH_FRAME_STATE_) || defined(_USE_SPATIAL_GRID_) || defined(_EYTZINGER_SEARCH_) || defined(_SWEPT_COLLISIONS_) \
+	|| defined(_MOVING_COLLISIONS_) || defined(_REMOVE_DESTROYED_CIRCLES_) || defined(_OUTPUT_ALL_) || defined(_RECORD_COLLISION_EVENTS_) \
+	|| defined(_EXPORT_THREAD_STATS_) || defined(_PAUSE_AFTER_EACH_FRAME_))
+#error _MULTI_PROCESS_ only supports the line sweep of moving against stationary circles
+#endif
+
 #pragma endregion
 
 #pragma region CONSTANTS
 
-constexpr unsigned int	NUM_OF_CIRCLES = 2000000;
-constexpr unsigned int	NUM_STATIONARY_CIRCLES = NUM_OF_CIRCLES / 2;
-constexpr unsigned int	NUM_MOVING_CIRCLES = NUM_OF_CIRCLES / 2;
-constexpr uint32_t		SPAWN_SEED = 17052021u;
+// Defaults for simulation_config. Each can be changed at startup from the command line or a config file
+constexpr uint32_t		DEFAULT_NUM_OF_CIRCLES = 2000000;
+constexpr uint32_t		DEFAULT_SPAWN_SEED = 17052021u;
+
+// Collision arrays are aligned to this so vector loads never split a line
+constexpr size_t		CACHE_LINE_SIZE = 64u;
+
+// Collisions each thread can queue for the log writer before it has to wait
+constexpr size_t		COLLISION_LOG_QUEUE_SIZE = 1u << 16;
+
+#ifdef _SWEPT_COLLISIONS_
+
+// Most stationary circles a moving circle can bounce off in one frame. Any motion left after that is dropped
+constexpr uint32_t		SWEPT_MAX_BOUNCES = 4u;
+
+#endif
+
+// Most moving circles a _MULTI_PROCESS_ rank can hand each neighbour at once. More just takes extra rounds
+constexpr uint32_t		MIGRATION_BATCH_SIZE = 4096u;
+
+// Moving circles are handed to threads in chunks of this many as they become free. Changed with the chunk_size option
+// Smaller balances better, bigger means less contention on the shared counter
+constexpr uint32_t		DEFAULT_COLLISION_CHUNK_SIZE = 1024u;
 
-const Vector2f X_SPAWN_RANGE = Vector2f(-1000.0f, 1000.0f);
-const Vector2f Y_SPAWN_RANGE = Vector2f(-1000.0f, 1000.0f);
+const Vector2f DEFAULT_X_SPAWN_RANGE = Vector2f(-1000.0f, 1000.0f);
+const Vector2f DEFAULT_Y_SPAWN_RANGE = Vector2f(-1000.0f, 1000.0f);
 
-const Vector2f X_VELOCITY_RANGE = Vector2f(-5.0f, 5.0f);
-const Vector2f Y_VELOCITY_RANGE = Vector2f(-5.0f, 5.0f);
+const Vector2f DEFAULT_X_VELOCITY_RANGE = Vector2f(-5.0f, 5.0f);
+const Vector2f DEFAULT_Y_VELOCITY_RANGE = Vector2f(-5.0f, 5.0f);
+
+// Only used with _RANDOM_RADIUS_
+const Vector2f DEFAULT_CIRCLE_RADIUS_RANGE = Vector2f(1.0f, 5.0f);
 
 #ifdef _USE_TL_ENGINE_
 
 const float CAMERA_MOVE_SPEED = 100.0f;
 const float CAMERA_ZOOM_SPEED = 1000.0f;
 
-const float CAMERA_START_Z = -((X_SPAWN_RANGE.y() - X_SPAWN_RANGE.x() + (Y_SPAWN_RANGE.y() - Y_SPAWN_RANGE.x())) / 2.0f);
-
-// Typically -1250 back from the spawn range for best results
-const Vector3f CAMERA_DEFAULT_POSITION = Vector3f(0.0f, 0.0f, CAMERA_START_Z - 1250.0f);
+// Camera starts this far further back than the spawn range is wide. Typically -1250 for best results
+const float CAMERA_BACK_OFFSET = -1250.0f;
 
 #endif
 
-#ifdef _RANDOM_RADIUS_
+#ifdef _MOVING_COLLISIONS_
 
-const Vector2f CIRCLE_RADIUS_RANGE = Vector2f(1.0f, 5.0f);
+// 3 passes of 11 bits covers the full 32 bit sort key
+constexpr uint32_t RADIX_BITS = 11u;
+constexpr uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+constexpr uint32_t RADIX_PASSES = 3u;
 
 #endif
 
@@ -74,69 +170,224 @@ const Vector2f CIRCLE_RADIUS_RANGE = Vector2f(1.0f, 5.0f);
 
 #pragma region CIRCLE STRUCTS
 
-struct stationary_circle_data
+// Collision data is stored as a structure of arrays. Each field is contiguous so a loop only pulls in the fields it reads
+// e.g. the line sweep walks just the x array. Every array comes from an aligned_arena so starts on a cache line
+// and can be loaded straight into vector registers
+struct stationary_collision_array
 {
-	Vector2f	position = Vector2f(0.0f, 0.0f);
-	float		radius = 1.0f;
-	size_t		uniqueIndex = 0u; // Line sweep requires this structure to have a index to the unique array
+	float*		x = nullptr;
+	float*		y = nullptr;
+	float*		radius = nullptr;
+	uint32_t*	uniqueIndex = nullptr; // Line sweep reorders circles so needs a index to the unique array
+	size_t		count = 0u;
+
+	// Alignment is passed on to each array, see aligned_arena::allocate
+	void allocate(aligned_arena& arena, size_t numCircles, size_t alignment = 0u)
+	{
+		x = arena.allocate<float>(numCircles, alignment);
+		y = arena.allocate<float>(numCircles, alignment);
+		radius = arena.allocate<float>(numCircles, alignment);
+		uniqueIndex = arena.allocate<uint32_t>(numCircles, alignment);
+		count = numCircles;
+	}
+
+	size_t size() const { return count; }
+
+	Vector2f position(size_t i) const { return Vector2f(x[i], y[i]); }
+};
+
+struct moving_collision_array
+{
+	float*	x = nullptr;
+	float*	y = nullptr;
+	float*	velocityX = nullptr;
+	float*	velocityY = nullptr;
+	float*		radius = nullptr;
+	// Only written by whichever thread has the circle. Stationary HP is hit from every thread so lives in its own atomic array
+	int32_t*	hp = nullptr;
+	// Spawn index of the circle in each slot. Circles change slots when others are removed or move between ranks,
+	// this stays with the circle so it is what logs and event files name it by
+	uint32_t*	id = nullptr;
+	size_t		count = 0u;
+
+	void allocate(aligned_arena& arena, size_t numCircles)
+	{
+		x = arena.allocate<float>(numCircles);
+		y = arena.allocate<float>(numCircles);
+		velocityX = arena.allocate<float>(numCircles);
+		velocityY = arena.allocate<float>(numCircles);
+		radius = arena.allocate<float>(numCircles);
+		hp = arena.allocate<int32_t>(numCircles);
+		id = arena.allocate<uint32_t>(numCircles);
+		count = numCircles;
+	}
+
+	size_t size() const { return count; }
+
+	Vector2f position(size_t i) const { return Vector2f(x[i], y[i]); }
+	Vector2f velocity(size_t i) const { return Vector2f(velocityX[i], velocityY[i]); }
+
+	void set_velocity(size_t i, const Vector2f& v)
+	{
+		velocityX[i] = v.x();
+		velocityY[i] = v.y();
+	}
+};
+
+#ifdef _MOVING_COLLISIONS_
+
+// Moving circles are sorted by this each frame. Key is the x position as an unsigned integer that sorts the same as the float
+struct moving_sort_key
+{
+	uint32_t	key = 0u;
+	uint32_t	index = 0u; // Index into the moving arrays
 };
 
-struct moving_circle_data
+// Copy of a moving circle in sorted order so the sweep walks memory linearly
+struct moving_sorted_circle
 {
 	Vector2f	position = Vector2f(0.0f, 0.0f);
-	Vector2f	velocity = Vector2f(0.0f, 0.0f);
 	float		radius = 1.0f;
+	uint32_t	index = 0u; // Index into the moving arrays
+};
+
+// A pair of moving circles that collided. Indexes into the moving arrays
+struct moving_circle_pair
+{
+	uint32_t	a = 0u;
+	uint32_t	b = 0u;
 };
 
-struct circle_unique_data
+#endif
+
+#ifdef _REMOVE_DESTROYED_CIRCLES_
+
+// A surviving moving circle copied into the slot of a destroyed one
+struct moving_circle_move
+{
+	uint32_t	from = 0u;
+	uint32_t	to = 0u;
+};
+
+#endif
+
+struct circle_color
 {
-	std::string name;
-	int32_t		hp = 100;
-	Vector3f	color = Vector3f(1.0f, 1.0f, 1.0f);
+	float r = 1.0f;
+	float g = 1.0f;
+	float b = 1.0f;
 };
 
+// Data the collision loop never touches, kept apart so it never shares a cache line with anything that does
+// Only read by visualisation and output
+struct circle_unique_array
+{
+	circle_color*	color = nullptr;
+	size_t			count = 0u;
+
+	void allocate(aligned_arena& arena, size_t numCircles)
+	{
+		color = arena.allocate<circle_color>(numCircles);
+		count = numCircles;
+	}
+
+	size_t size() const { return count; }
+};
+
+// Names are never stored, they are built from the index when something needs to show one
+inline std::string stationary_circle_name(size_t uniqueIndex) { return "S" + std::to_string(uniqueIndex); }
+inline std::string moving_circle_name(size_t id) { return "M" + std::to_string(id); }
+
 #pragma endregion
 
 #pragma region THREADING STRUCTS
 
-// The worker pool contains these types
-// Wakes up on signal, signals back when complete
-// Mutex guards data
-struct worker_thread
+// Each frame is split into phases. Every thread runs the same phase on its own section before the next one starts
+enum class work_phase
 {
-	std::thread				thread;
-	std::condition_variable workReady;
-	std::mutex				lock;
+	collide_stationary,	// Move then collide moving vs stationary circles
+	sort_histogram,		// Count radix buckets of the current pass
+	sort_scatter,		// Move keys to their sorted position for the current pass
+	collide_moving,		// Moving vs moving circles
+	fill_destroyed,		// Copy surviving moving circles into the slots of destroyed ones
 };
 
+inline const char* work_phase_name(work_phase phase)
+{
+	switch (phase)
+	{
+	case work_phase::collide_stationary:
+		return "collide_stationary";
+	case work_phase::sort_histogram:
+		return "sort_histogram";
+	case work_phase::sort_scatter:
+		return "sort_scatter";
+	case work_phase::collide_moving:
+		return "collide_moving";
+	case work_phase::fill_destroyed:
+		return "fill_destroyed";
+	default:
+		return "unknown";
+	}
+}
+
 // This is the structure used by the worker threads to process a collision
-struct collision_work
+// Each thread writes its own counters into this every collision so it gets its own cache lines
+struct alignas(CACHE_LINE_SIZE) collision_work
 {
-	// Used to avoid suprious wake ups
-	bool complete = true;
+	// What to do when woken up
+	work_phase phase = work_phase::collide_stationary;
+
+	// Main thread is the last index
+	uint32_t threadIndex = 0u;
 
 	// Pointer to full array of stationary circles
-	stationary_circle_data* sCirclesCol = nullptr;
-	circle_unique_data* sCirclesUnique = nullptr;
-	std::mutex* sCirclesMutexes = nullptr;
+	stationary_collision_array* sCirclesCol = nullptr;
+	std::atomic<int32_t>* sCirclesHP = nullptr;
 
-	// Pointer to moving circles section
-	moving_circle_data* mCirclesCol = nullptr;
-	circle_unique_data* mCircleUnique = nullptr;
+	// Pointer to full array of moving circles. The current chunk is mFirstCircle to mFirstCircle + mNumberOfCircles
+	moving_collision_array* mCirclesCol = nullptr;
+	size_t					mFirstCircle = 0u;
 	size_t					mNumberOfCircles = 0u;
 	
 	#ifdef _TRACK_COLLISIONS_
 	// how many collision happened in this threads work
 	uint32_t numberOfCollisions = 0u;
 	#endif
-	
-};
 
-// Not sure if ill need this but nice to have
-struct paired_worker
-{
-	worker_thread	worker;
-	collision_work	work;
+	#ifdef _TIME_THREADS_
+	// Seconds spent processing phases this frame
+	float busyTime = 0.0f;
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	// Counted for the current phase then handed to the stats writer
+	uint64_t candidatesTested = 0u;
+	uint32_t phaseHits = 0u;
+	#endif
+
+	#ifdef _USE_SPATIAL_GRID_
+	// Grid is stored compressed. Cell c owns sGridIndices[sGridCellStarts[c]] to sGridIndices[sGridCellStarts[c + 1]]
+	const uint32_t* sGridCellStarts = nullptr;
+	const uint32_t* sGridIndices = nullptr;
+	#endif
+
+	#ifdef _MOVING_COLLISIONS_
+	// Pairs that cross into another chunk. Resolved by the main thread once everyone has finished
+	std::vector<moving_circle_pair> deferredPairs;
+	#endif
+
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	// Circles whose HP reached 0 this frame. Stationary are sorted indexes, so into sCirclesCol rather than the HP array
+	std::vector<uint32_t> destroyedStationary;
+	std::vector<uint32_t> destroyedMoving;
+	#endif
+
+	#ifdef _PROFILE_ZONES_
+	// Stationary circles the current moving circle hit. Resolved once its sweep is done so resolving can be timed per circle
+	std::vector<uint32_t> sweepHits;
+	#endif
+	
 };
 
 #pragma endregion
@@ -144,13 +395,8 @@ struct paired_worker
 #pragma region USING SHORTENERS
 
 // Shorten super long array types
-typedef std::array<stationary_circle_data, NUM_STATIONARY_CIRCLES>	stationary_collision_array;
-typedef std::array<circle_unique_data, NUM_STATIONARY_CIRCLES>		stationary_unique_array;
-typedef std::array<std::mutex, NUM_STATIONARY_CIRCLES>				stationary_mutex_array;
-typedef std::array<moving_circle_data, NUM_MOVING_CIRCLES>			moving_collision_array;
-typedef std::array<circle_unique_data, NUM_MOVING_CIRCLES>			moving_unique_array;
-
-// Shorten horrid random syntax
-typedef std::uniform_real_distribution<float> rand_float_dist;
+// Collision arrays are structures of arrays declared with the circle structs
+typedef circle_unique_array	stationary_unique_array;
+typedef circle_unique_array	moving_unique_array;
 
 #pragma endregion
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "density_raster.hpp"
+
+#include "frame_publisher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	// A sample is the pixel within its tile in the low bits and the circles HP above
+	constexpr uint32_t PIXEL_BITS = 12u;
+	constexpr uint32_t PIXEL_MASK = (1u << PIXEL_BITS) - 1u;
+	constexpr int32_t MAX_SAMPLE_HP = static_cast<int32_t>(0xFFFFFFFFu >> PIXEL_BITS);
+
+	static_assert(density_raster::TILE_SIZE * density_raster::TILE_SIZE <= (1u << PIXEL_BITS), "Pixel in tile doesn't fit in a sample");
+
+	// Every circle starts with this much HP. Pixels are full green at it
+	constexpr float STARTING_HP = 100.0f;
+
+	// Pixels this many times busier than average are full brightness
+	constexpr float BRIGHTNESS_SATURATION = 8.0f;
+
+	uint32_t pack_sample(uint32_t pixelInTile, int32_t hp)
+	{
+		return pixelInTile | (static_cast<uint32_t>(std::min(std::max(hp, 0), MAX_SAMPLE_HP)) << PIXEL_BITS);
+	}
+
+	// Same split as the simulator, so every thread gets an even share
+	void thread_range(uint32_t threadIndex, uint32_t numThreads, size_t count, size_t& begin, size_t& end)
+	{
+		begin = count * threadIndex / numThreads;
+		end = count * (threadIndex + 1u) / numThreads;
+	}
+}
+
+density_raster::density_raster(uint32_t width, uint32_t height, const Vector2f& xRange, const Vector2f& yRange, uint32_t numThreads) :
+	m_Width(width), m_Height(height),
+	m_TilesX((width + TILE_SIZE - 1u) / TILE_SIZE), m_TilesY((height + TILE_SIZE - 1u) / TILE_SIZE),
+	m_NumThreads(numThreads)
+{
+	if (width == 0u || height == 0u)
+	{
+		throw std::runtime_error("Raster image needs at least one pixel");
+	}
+
+	m_XMin = xRange.x();
+	m_YMax = yRange.y();
+	m_XScale = static_cast<float>(width) / (xRange.y() - xRange.x());
+	m_YScale = static_cast<float>(height) / (yRange.y() - yRange.x());
+
+	// Rows are written by different threads so never share a cache line
+	const uint32_t countsPerLine = CACHE_LINE_SIZE / sizeof(uint32_t);
+	const auto numTiles = m_TilesX * m_TilesY;
+	m_CountStride = (numTiles + countsPerLine - 1u) / countsPerLine * countsPerLine;
+	m_TileCounts.resize(static_cast<size_t>(m_CountStride) * numThreads);
+	m_TileStarts.resize(numTiles + 1u, 0u);
+
+	m_Pixels.resize(static_cast<size_t>(width) * height * 3u, 0u);
+}
+
+template <typename StationaryHP, typename MovingHP>
+void density_raster::draw_circles(thread_pool& pool, const float* sx, const float* sy, size_t numStationary, const StationaryHP& stationaryHPOf,
+	const float* mx, const float* my, size_t numMoving, const MovingHP& movingHPOf)
+{
+	pool.run([&](uint32_t threadIndex)
+	{
+		auto* counts = &m_TileCounts[static_cast<size_t>(threadIndex) * m_CountStride];
+		std::fill(counts, counts + m_CountStride, 0u);
+		count_tiles(threadIndex, sx, sy, numStationary);
+		count_tiles(threadIndex, mx, my, numMoving);
+	});
+
+	counts_to_offsets();
+	// Only grows, and circles are never added so it settles after the first frame
+	if (m_Samples.size() < circles_drawn())
+	{
+		m_Samples.resize(circles_drawn());
+	}
+
+	// Same circles in the same order as counting, so each thread fills exactly the space it counted
+	pool.run([&](uint32_t threadIndex)
+	{
+		scatter_samples(threadIndex, sx, sy, numStationary, stationaryHPOf);
+		scatter_samples(threadIndex, mx, my, numMoving, movingHPOf);
+	});
+
+	// Scaled to how crowded the image is on average, so it looks the same for any circle count or image size
+	const auto averageCount = static_cast<float>(circles_drawn()) / (static_cast<float>(m_Width) * static_cast<float>(m_Height));
+	const auto saturation = std::max(4u, static_cast<uint32_t>(std::ceil(averageCount * BRIGHTNESS_SATURATION)));
+	m_Brightness.resize(saturation + 1u);
+	for (auto count = 0u; count <= saturation; ++count)
+	{
+		m_Brightness[count] = std::log1p(static_cast<float>(count)) / std::log1p(static_cast<float>(saturation));
+	}
+
+	m_NextTile.store(0u, std::memory_order_relaxed);
+	pool.run([&](uint32_t)
+	{
+		shade_tiles();
+	});
+}
+
+template <typename HP>
+void density_raster::scatter_samples(uint32_t threadIndex, const float* x, const float* y, size_t count, const HP& hpOf)
+{
+	auto* offsets = &m_TileCounts[static_cast<size_t>(threadIndex) * m_CountStride];
+	auto* samples = m_Samples.data();
+
+	uint32_t tile, pixelInTile;
+	size_t begin, end;
+	thread_range(threadIndex, m_NumThreads, count, begin, end);
+	for (auto i = begin; i < end; ++i)
+	{
+		if (locate(x[i], y[i], tile, pixelInTile))
+		{
+			samples[offsets[tile]++] = pack_sample(pixelInTile, hpOf(i));
+		}
+	}
+}
+
+void density_raster::draw(thread_pool& pool, const stationary_collision_array& sColData, const std::atomic<int32_t>* sHP, const moving_collision_array& mColData)
+{
+	draw_circles(pool, sColData.x, sColData.y, sColData.size(), [&](size_t i) { return sHP[sColData.uniqueIndex[i]].load(std::memory_order_relaxed); },
+		mColData.x, mColData.y, mColData.size(), [&](size_t i) { return mColData.hp[i]; });
+}
+
+void density_raster::draw(thread_pool& pool, const frame_state& state)
+{
+	draw_circles(pool, state.stationaryX.data(), state.stationaryY.data(), state.numStationary, [&](size_t i) { return state.stationaryHP[state.stationaryUniqueIndex[i]]; },
+		state.movingX.data(), state.movingY.data(), state.numMoving, [&](size_t i) { return state.movingHP[i]; });
+}
+
+void density_raster::write_ppm(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << m_Width << ' ' << m_Height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(m_Pixels.data()), static_cast<std::streamsize>(m_Pixels.size()));
+	if (!file)
+	{
+		throw std::runtime_error("Could not write raster image " + path);
+	}
+}
+
+bool density_raster::locate(float x, float y, uint32_t& tile, uint32_t& pixelInTile) const
+{
+	const auto px = (x - m_XMin) * m_XScale;
+	const auto py = (m_YMax - y) * m_YScale;
+	// Written so NaN is outside too
+	if (!(px >= 0.0f && px < static_cast<float>(m_Width) && py >= 0.0f && py < static_cast<float>(m_Height)))
+	{
+		return false;
+	}
+
+	// Rounding can still land exactly on the far edge
+	const auto column = std::min(static_cast<uint32_t>(px), m_Width - 1u);
+	const auto row = std::min(static_cast<uint32_t>(py), m_Height - 1u);
+	tile = (row / TILE_SIZE) * m_TilesX + column / TILE_SIZE;
+	pixelInTile = (row % TILE_SIZE) * TILE_SIZE + column % TILE_SIZE;
+	return true;
+}
+
+void density_raster::count_tiles(uint32_t threadIndex, const float* x, const float* y, size_t count)
+{
+	auto* counts = &m_TileCounts[static_cast<size_t>(threadIndex) * m_CountStride];
+
+	uint32_t tile, pixelInTile;
+	size_t begin, end;
+	thread_range(threadIndex, m_NumThreads, count, begin, end);
+	for (auto i = begin; i < end; ++i)
+	{
+		if (locate(x[i], y[i], tile, pixelInTile))
+		{
+			++counts[tile];
+		}
+	}
+}
+
+void density_raster::counts_to_offsets()
+{
+	// Tile by tile, and within a tile thread by thread, so each thread writes its samples of a tile in one run
+	uint32_t offset = 0u;
+	for (uint32_t tile = 0u; tile < m_TilesX * m_TilesY; ++tile)
+	{
+		m_TileStarts[tile] = offset;
+		for (auto thread = 0u; thread < m_NumThreads; ++thread)
+		{
+			auto& count = m_TileCounts[static_cast<size_t>(thread) * m_CountStride + tile];
+			const auto tileCount = count;
+			count = offset;
+			offset += tileCount;
+		}
+	}
+	m_TileStarts.back() = offset;
+}
+
+void density_raster::shade_tiles()
+{
+	uint32_t counts[TILE_SIZE * TILE_SIZE];
+	uint32_t hpSums[TILE_SIZE * TILE_SIZE];
+
+	const auto numTiles = m_TilesX * m_TilesY;
+	const auto saturation = static_cast<uint32_t>(m_Brightness.size() - 1u);
+	for (auto tile = m_NextTile.fetch_add(1u, std::memory_order_relaxed); tile < numTiles; tile = m_NextTile.fetch_add(1u, std::memory_order_relaxed))
+	{
+		std::fill(std::begin(counts), std::end(counts), 0u);
+		std::fill(std::begin(hpSums), std::end(hpSums), 0u);
+
+		for (auto s = m_TileStarts[tile]; s < m_TileStarts[tile + 1u]; ++s)
+		{
+			const auto sample = m_Samples[s];
+			++counts[sample & PIXEL_MASK];
+			hpSums[sample & PIXEL_MASK] += sample >> PIXEL_BITS;
+		}
+
+		// Tiles on the right and bottom edges can hang off the image
+		const auto left = (tile % m_TilesX) * TILE_SIZE;
+		const auto top = (tile / m_TilesX) * TILE_SIZE;
+		const auto columns = std::min(TILE_SIZE, m_Width - left);
+		const auto rows = std::min(TILE_SIZE, m_Height - top);
+		for (auto row = 0u; row < rows; ++row)
+		{
+			auto* pixel = &m_Pixels[((static_cast<size_t>(top) + row) * m_Width + left) * 3u];
+			for (auto column = 0u; column < columns; ++column, pixel += 3)
+			{
+				const auto count = counts[row * TILE_SIZE + column];
+				const auto brightness = 255.0f * m_Brightness[std::min(count, saturation)];
+				const auto health = count == 0u ? 0.0f : std::min(1.0f, static_cast<float>(hpSums[row * TILE_SIZE + column]) / (static_cast<float>(count) * STARTING_HP));
+
+				pixel[0] = static_cast<uint8_t>(brightness * (1.0f - health));
+				pixel[1] = static_cast<uint8_t>(brightness * health);
+				pixel[2] = 0u;
+			}
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "defines.hpp"
+#include "libraries/thread_pool.hpp"
+
+struct frame_state;
+
+// Heatmap of how many circles are in each pixel and how hurt they are, drawn headless over the thread pool
+// Brightness is the number of circles, green to red is their average HP. Circles are drawn as the pixel their centre is in
+//
+// The image is split into square tiles and drawn in three steps, the same way the radix sort of moving circles works
+//	1. each thread counts how many of its share of the circles land in each tile
+//	2. the counts become offsets so the circles of a tile end up together, then each thread copies its circles there
+//	3. threads take whole tiles from a shared cursor and add up the circles into a tile sized buffer of their own
+// So no two threads ever write the same pixel, and the pixels being added to stay in L1
+class density_raster
+{
+public:
+	// Tiles are this many pixels square. Pixel within a tile has to fit in a sample
+	static const uint32_t TILE_SIZE = 64u;
+
+	// Maps the spawn range onto the image. Circles that have moved outside it aren't drawn
+	// Throws std::runtime_error if the image has no pixels
+	density_raster(uint32_t width, uint32_t height, const Vector2f& xRange, const Vector2f& yRange, uint32_t numThreads);
+
+	density_raster(const density_raster&) = delete;
+	density_raster& operator=(const density_raster&) = delete;
+
+	// Draws every circle into the image. Uses every thread in the pool so call between frames
+	void draw(thread_pool& pool, const stationary_collision_array& sColData, const std::atomic<int32_t>* sHP, const moving_collision_array& mColData);
+	// As above from a published copy of the circles, e.g. on a consumer thread with its own pool
+	void draw(thread_pool& pool, const frame_state& state);
+
+	// Binary PPM of the last image drawn. Throws std::runtime_error if the file can't be written
+	void write_ppm(const std::string& path) const;
+
+	uint32_t width() const { return m_Width; }
+	uint32_t height() const { return m_Height; }
+
+	// RGB, 3 bytes a pixel, top row first
+	const std::vector<uint8_t>& pixels() const { return m_Pixels; }
+
+	// Circles drawn by the last draw, so not counting those outside the image
+	uint32_t circles_drawn() const { return m_TileStarts.back(); }
+
+private:
+	// Tile the circle at x, y is in and where in the tile. False if it's outside the image
+	bool locate(float x, float y, uint32_t& tile, uint32_t& pixelInTile) const;
+
+	// Both draws. hpOf(i) is the HP of circle i of that type
+	template <typename StationaryHP, typename MovingHP>
+	void draw_circles(thread_pool& pool, const float* sx, const float* sy, size_t numStationary, const StationaryHP& stationaryHPOf,
+		const float* mx, const float* my, size_t numMoving, const MovingHP& movingHPOf);
+
+	// Each step for one thread, on its share of one type of circle
+	void count_tiles(uint32_t threadIndex, const float* x, const float* y, size_t count);
+	template <typename HP>
+	void scatter_samples(uint32_t threadIndex, const float* x, const float* y, size_t count, const HP& hpOf);
+	void shade_tiles();
+
+	// Counts of every thread for each tile into where each thread writes its first sample of it
+	void counts_to_offsets();
+
+	const uint32_t m_Width;
+	const uint32_t m_Height;
+	const uint32_t m_TilesX;
+	const uint32_t m_TilesY;
+	const uint32_t m_NumThreads;
+
+	// Spawn range to pixels. y is flipped so bigger y is further up the image
+	float m_XMin;
+	float m_YMax;
+	float m_XScale;
+	float m_YScale;
+
+	// Circles each thread found in each tile, one row per thread padded to a cache line. Offsets once counts_to_offsets has run
+	uint32_t m_CountStride;
+	std::vector<uint32_t> m_TileCounts;
+	// First sample of each tile, with one extra entry so the last tile has an end
+	std::vector<uint32_t> m_TileStarts;
+	// Circles grouped by tile. Pixel in the tile in the low bits, HP above
+	std::vector<uint32_t> m_Samples;
+
+	// Brightness of a pixel with that many circles in it. Anything more is full brightness
+	std::vector<float> m_Brightness;
+
+	// Next tile to hand out while shading
+	std::atomic<uint32_t> m_NextTile = { 0u };
+
+	std::vector<uint8_t> m_Pixels;
+};
@@ -0,0 +1,107 @@
+#include "frame_publisher.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// Same split as the simulator, so every thread gets an even share
+	void thread_range(uint32_t threadIndex, uint32_t numThreads, size_t count, size_t& begin, size_t& end)
+	{
+		begin = count * threadIndex / numThreads;
+		end = count * (threadIndex + 1u) / numThreads;
+	}
+}
+
+frame_publisher::frame_publisher(size_t numStationary, size_t numMoving)
+{
+	for (auto i = 0u; i < 3u; ++i)
+	{
+		auto& state = m_States.buffer(i);
+		state.stationaryX.resize(numStationary);
+		state.stationaryY.resize(numStationary);
+		state.stationaryUniqueIndex.resize(numStationary);
+		state.stationaryHP.resize(numStationary);
+		state.movingX.resize(numMoving);
+		state.movingY.resize(numMoving);
+		state.movingHP.resize(numMoving);
+	}
+}
+
+frame_publisher::~frame_publisher()
+{
+	m_Stop.store(true);
+	if (m_Consumer.joinable())
+	{
+		m_Consumer.join();
+	}
+}
+
+void frame_publisher::add_consumer(const consumer& consume)
+{
+	m_Consumers.push_back(consume);
+}
+
+void frame_publisher::start()
+{
+	m_Consumer = std::thread(&frame_publisher::consumer_loop, this);
+}
+
+void frame_publisher::publish(thread_pool& pool, uint32_t frame, uint64_t stationaryVersion,
+	const stationary_collision_array& sColData, const std::atomic<int32_t>* sHP, const moving_collision_array& mColData)
+{
+	auto& state = m_States.back();
+	// This copy was last filled two frames ago, so may have stationary positions from before circles were removed
+	const bool copyStationary = state.stationaryVersion != stationaryVersion;
+
+	pool.run([&](uint32_t threadIndex)
+	{
+		size_t begin, end;
+		if (copyStationary)
+		{
+			thread_range(threadIndex, pool.num_threads(), sColData.size(), begin, end);
+			std::copy(sColData.x + begin, sColData.x + end, state.stationaryX.begin() + begin);
+			std::copy(sColData.y + begin, sColData.y + end, state.stationaryY.begin() + begin);
+			std::copy(sColData.uniqueIndex + begin, sColData.uniqueIndex + end, state.stationaryUniqueIndex.begin() + begin);
+		}
+
+		// HP stays where it is when circles are removed, so always the whole array
+		thread_range(threadIndex, pool.num_threads(), state.stationaryHP.size(), begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			state.stationaryHP[i] = sHP[i].load(std::memory_order_relaxed);
+		}
+
+		thread_range(threadIndex, pool.num_threads(), mColData.size(), begin, end);
+		std::copy(mColData.x + begin, mColData.x + end, state.movingX.begin() + begin);
+		std::copy(mColData.y + begin, mColData.y + end, state.movingY.begin() + begin);
+		std::copy(mColData.hp + begin, mColData.hp + end, state.movingHP.begin() + begin);
+	});
+
+	state.frame = frame;
+	state.stationaryVersion = stationaryVersion;
+	state.numStationary = sColData.size();
+	state.numMoving = mColData.size();
+
+	m_States.publish();
+	++m_FramesPublished;
+}
+
+void frame_publisher::consumer_loop()
+{
+	while (!m_Stop.load())
+	{
+		if (!m_States.update())
+		{
+			// Nothing new. Sleep rather than spin on a core the workers could be using
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			continue;
+		}
+
+		for (const auto& consume : m_Consumers)
+		{
+			consume(m_States.front());
+		}
+		m_FramesConsumed.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "defines.hpp"
+#include "libraries/thread_pool.hpp"
+#include "libraries/triple_buffer.hpp"
+
+// Copy of where every circle was and its HP at the end of a frame. Never changes once published
+struct frame_state
+{
+	// Frames simulated when it was copied
+	uint32_t	frame = 0u;
+
+	// Stationary circles only move when destroyed ones are removed, so their positions are only copied when this differs
+	uint64_t	stationaryVersion = 0u;
+	size_t		numStationary = 0u;
+	std::vector<float>		stationaryX;
+	std::vector<float>		stationaryY;
+	std::vector<uint32_t>	stationaryUniqueIndex;
+	// By unique index like the live HP array
+	std::vector<int32_t>	stationaryHP;
+
+	size_t		numMoving = 0u;
+	std::vector<float>		movingX;
+	std::vector<float>		movingY;
+	std::vector<int32_t>	movingHP;
+};
+
+// Publishes a frame_state at the end of each frame for consumers (renderers, exporters...) to read on a thread of their own
+// States are triple buffered so the simulation never waits for a consumer. Consumers that are slower than the simulation
+// just skip to the latest frame, so their speed never shows in the frame time. Only the copy does
+class frame_publisher
+{
+public:
+	// Runs on the consumer thread for each frame it picks up
+	typedef std::function<void(const frame_state&)> consumer;
+
+	// Sizes every copy for the most circles there can ever be
+	frame_publisher(size_t numStationary, size_t numMoving);
+
+	// Stops the consumer thread once it has finished the frame it's on
+	~frame_publisher();
+
+	frame_publisher(const frame_publisher&) = delete;
+	frame_publisher& operator=(const frame_publisher&) = delete;
+
+	// Consumers run in the order they were added. Only before start()
+	void add_consumer(const consumer& consume);
+
+	// Starts the consumer thread
+	void start();
+
+	// Copies the circles into the next state over every thread in the pool, then hands it to the consumers
+	// stationaryVersion has to change whenever the stationary arrays do. Call between frames
+	void publish(thread_pool& pool, uint32_t frame, uint64_t stationaryVersion,
+		const stationary_collision_array& sColData, const std::atomic<int32_t>* sHP, const moving_collision_array& mColData);
+
+	// Frames published, and how many of those the consumers have seen
+	uint32_t frames_published() const { return m_FramesPublished; }
+	uint32_t frames_consumed() const { return m_FramesConsumed.load(std::memory_order_relaxed); }
+
+private:
+	void consumer_loop();
+
+	triple_buffer<frame_state> m_States;
+	std::vector<consumer> m_Consumers;
+
+	uint32_t m_FramesPublished = 0u;
+	std::atomic<uint32_t> m_FramesConsumed = { 0u };
+
+	std::atomic<bool>	m_Stop = { false };
+	std::thread			m_Consumer;
+};
@@ -0,0 +1,179 @@
+#include "aligned_arena.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	// MSVC has no std::aligned_alloc so each platform gets its own pair
+	void* aligned_block_alloc(size_t alignment, size_t size)
+	{
+	#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+	#else
+		return std::aligned_alloc(alignment, size);
+	#endif
+	}
+
+	void aligned_block_free(void* memory)
+	{
+	#ifdef _WIN32
+		_aligned_free(memory);
+	#else
+		std::free(memory);
+	#endif
+	}
+
+	size_t round_up(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+}
+
+aligned_arena::aligned_arena(size_t alignment, size_t blockSize, page_mode pages) : m_Alignment(alignment), m_BlockSize(round_up(blockSize, alignment)), m_Pages(pages)
+{
+}
+
+aligned_arena::~aligned_arena()
+{
+	release();
+}
+
+void* aligned_arena::allocate_bytes(size_t bytes, size_t alignment)
+{
+	if (bytes == 0u)
+	{
+		return nullptr;
+	}
+	alignment = alignment == 0u ? m_Alignment : round_up(alignment, m_Alignment);
+	if (bytes > SIZE_MAX - alignment)
+	{
+		throw std::bad_alloc();
+	}
+
+	// Padding every allocation up to the alignment keeps the next one aligned too
+	bytes = round_up(bytes, alignment);
+
+	// Bump the current block if it has room. Skipped bytes count as allocated, like padding
+	if (!m_Blocks.empty())
+	{
+		auto& current = m_Blocks.back();
+		const auto address = reinterpret_cast<uintptr_t>(current.memory);
+		const auto start = round_up(address + current.used, alignment) - address;
+		if (start <= current.size && current.size - start >= bytes)
+		{
+			auto* memory = current.memory + start;
+			m_BytesAllocated += start + bytes - current.used;
+			current.used = start + bytes;
+			return memory;
+		}
+	}
+
+	// Big arrays get a block to themselves so they don't waste the rest of the current one
+	const bool dedicated = bytes >= m_BlockSize;
+
+	// Make room first so adding the block can't throw after the memory is taken
+	m_Blocks.reserve(m_Blocks.size() + 1u);
+
+	block newBlock;
+	newBlock.size = dedicated ? bytes : m_BlockSize;
+	newBlock.used = bytes;
+	newBlock.memory = allocate_block(newBlock.size, alignment);
+
+	// Current block is always the last one
+	if (dedicated && !m_Blocks.empty())
+	{
+		m_Blocks.insert(m_Blocks.end() - 1, newBlock);
+	}
+	else
+	{
+		m_Blocks.push_back(newBlock);
+	}
+
+	m_BytesAllocated += bytes;
+	m_BytesReserved += newBlock.size;
+	return newBlock.memory;
+}
+
+void aligned_arena::release()
+{
+	for (auto& memoryBlock : m_Blocks)
+	{
+		free_block(memoryBlock);
+	}
+	m_Blocks.clear();
+
+	m_BytesAllocated = 0u;
+	m_BytesReserved = 0u;
+}
+
+char* aligned_arena::allocate_block(size_t& size, size_t alignment)
+{
+	if (m_Pages == page_mode::explicit_huge)
+	{
+	#ifdef _WIN32
+		// Needs the "Lock pages in memory" privilege
+		const auto largePageSize = std::max<size_t>(GetLargePageMinimum(), 1u);
+		// Large pages are at least as big as any page interleaved, so any alignment asked for is met
+		size = round_up(size, largePageSize);
+		auto* memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory == nullptr)
+		{
+			throw std::runtime_error("Could not allocate " + std::to_string(size) + " bytes of large pages. The user needs the Lock pages in memory privilege");
+		}
+	#else
+		size = round_up(size, HUGE_PAGE_SIZE);
+		auto* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory == MAP_FAILED)
+		{
+			throw std::runtime_error("Could not allocate " + std::to_string(size) + " bytes of huge pages. Reserve more with /proc/sys/vm/nr_hugepages");
+		}
+	#endif
+		return static_cast<char*>(memory);
+	}
+
+	// Whole huge pages, so the first and last of the block can be huge too
+	const bool huge = m_Pages == page_mode::transparent_huge;
+	alignment = huge ? std::max<size_t>(alignment, HUGE_PAGE_SIZE) : alignment;
+	size = round_up(size, alignment);
+
+	auto* memory = static_cast<char*>(aligned_block_alloc(alignment, size));
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	#ifdef MADV_HUGEPAGE
+	// Only a hint. Still works with normal pages if the kernel has none to spare, or has them turned off
+	if (huge)
+	{
+		madvise(memory, size, MADV_HUGEPAGE);
+	}
+	#endif
+	return memory;
+}
+
+void aligned_arena::free_block(const block& memoryBlock)
+{
+	if (m_Pages == page_mode::explicit_huge)
+	{
+	#ifdef _WIN32
+		VirtualFree(memoryBlock.memory, 0, MEM_RELEASE);
+	#else
+		munmap(memoryBlock.memory, memoryBlock.size);
+	#endif
+		return;
+	}
+	aligned_block_free(memoryBlock.memory);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator handing out uninitialised, aligned arrays from a few large blocks
+// Made for data that is sized once at startup and lives until shutdown, so nothing is freed individually
+// Every allocation starts on an alignment boundary so separate arrays never share a cache line
+//
+// Nothing is constructed or destroyed. Callers write every element before reading it,
+// or placement new types that need constructing (e.g. atomics)
+//
+// Blocks can be backed by huge pages so big arrays searched at random take far fewer TLB misses
+class aligned_arena
+{
+public:
+	// Arrays bigger than this get a block of their own
+	static const size_t DEFAULT_BLOCK_SIZE = 16u * 1024u * 1024u;
+
+	// Size of a huge page on x86. Blocks are rounded up to this when using them
+	static const size_t HUGE_PAGE_SIZE = 2u * 1024u * 1024u;
+
+	enum class page_mode
+	{
+		// Whatever the allocator gives
+		normal,
+		// Blocks are huge page aligned and the kernel is asked to back them with huge pages when it can. Linux only, normal elsewhere
+		transparent_huge,
+		// Blocks come straight from the reserved huge page pool (Linux hugetlbfs, Windows large pages)
+		explicit_huge,
+	};
+
+	// Throws std::runtime_error later, when a block is needed, if explicit huge pages can't be had
+	explicit aligned_arena(size_t alignment = 64u, size_t blockSize = DEFAULT_BLOCK_SIZE, page_mode pages = page_mode::normal);
+
+	// Frees every block
+	~aligned_arena();
+
+	aligned_arena(const aligned_arena&) = delete;
+	aligned_arena& operator=(const aligned_arena&) = delete;
+
+	// Space for count T's. Throws std::bad_alloc if it can't be allocated, or std::runtime_error if explicit huge pages run out
+	// A page size as the alignment gives the array whole pages of its own, which nothing else allocated is on
+	template <typename T>
+	T* allocate(size_t count, size_t alignment = 0u)
+	{
+		// The arena never runs destructors
+		static_assert(std::is_trivially_destructible<T>::value, "aligned_arena only holds trivially destructible types");
+
+		if (alignof(T) > m_Alignment || count > SIZE_MAX / sizeof(T))
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(allocate_bytes(count * sizeof(T), alignment));
+	}
+
+	// Raw bytes starting and ending on a multiple of alignment, or of the arenas alignment for 0. nullptr for 0 bytes
+	// Alignment is rounded up to a multiple of the arenas
+	void* allocate_bytes(size_t bytes, size_t alignment = 0u);
+
+	// Frees every block. Everything handed out so far is invalid after this
+	void release();
+
+	// Bytes handed out, including padding up to the alignment
+	size_t bytes_allocated() const { return m_BytesAllocated; }
+	// Bytes held in blocks
+	size_t bytes_reserved() const { return m_BytesReserved; }
+
+	size_t alignment() const { return m_Alignment; }
+
+	page_mode pages() const { return m_Pages; }
+
+private:
+	struct block
+	{
+		char*	memory = nullptr;
+		size_t	size = 0u;
+		size_t	used = 0u;
+	};
+
+	// Memory for a block of at least size bytes, starting on a multiple of alignment
+	// Size is rounded up to a whole number of pages for the page mode
+	char* allocate_block(size_t& size, size_t alignment);
+	void free_block(const block& memoryBlock);
+
+	const size_t m_Alignment;
+	const size_t m_BlockSize;
+	const page_mode m_Pages;
+
+	std::vector<block> m_Blocks;
+
+	size_t m_BytesAllocated = 0u;
+	size_t m_BytesReserved = 0u;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+// Random numbers as a pure function of (seed, stream, counter) rather than a sequence
+// Any thread can make the number for any counter without making the ones before it, so work split
+// between threads gets exactly the same numbers however it is split
+//
+// Each stream is an independent SplitMix64 sequence. Use a stream per field and the item index as the counter
+class counter_rng
+{
+public:
+	counter_rng(uint64_t seed, uint32_t stream) : m_Key(mix(seed ^ mix(static_cast<uint64_t>(stream) + GOLDEN_GAMMA)))
+	{
+	}
+
+	uint64_t bits(uint64_t counter) const
+	{
+		return mix(m_Key + (counter + 1u) * GOLDEN_GAMMA);
+	}
+
+	// Uniform in [min, max)
+	float uniform(uint64_t counter, float min, float max) const
+	{
+		// Top 24 bits exactly fill a float mantissa
+		const auto unit = static_cast<float>(bits(counter) >> 40) * (1.0f / 16777216.0f);
+		return min + (max - min) * unit;
+	}
+
+private:
+	static const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+	// SplitMix64 finaliser. Every input bit affects every output bit
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t m_Key;
+};
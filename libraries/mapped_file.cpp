@@ -0,0 +1,112 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& path, access mode)
+{
+	const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Could not open " + path);
+	}
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Could not get the size of " + path);
+	}
+	m_Size = static_cast<size_t>(size.QuadPart);
+	if (m_Size == 0u)
+	{
+		return;
+	}
+
+	const bool copyOnWrite = mode == access::copy_on_write;
+	m_Mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+	if (m_Mapping != nullptr)
+	{
+		m_Data = static_cast<uint8_t*>(MapViewOfFile(m_Mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+	}
+	if (m_Data == nullptr)
+	{
+		if (m_Mapping != nullptr)
+		{
+			CloseHandle(m_Mapping);
+		}
+		CloseHandle(file);
+		throw std::runtime_error("Could not map " + path);
+	}
+}
+
+mapped_file::~mapped_file()
+{
+	if (m_Data != nullptr)
+	{
+		UnmapViewOfFile(m_Data);
+	}
+	if (m_Mapping != nullptr)
+	{
+		CloseHandle(m_Mapping);
+	}
+	CloseHandle(m_File);
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& path, access mode)
+{
+	const auto file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("Could not open " + path);
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		throw std::runtime_error("Could not get the size of " + path);
+	}
+	m_Size = static_cast<size_t>(status.st_size);
+
+	if (m_Size != 0u)
+	{
+		// Private mappings never write back to the file, so a read only descriptor is enough even for copy on write
+		const auto protection = mode == access::copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+		const auto mapped = mmap(nullptr, m_Size, protection, MAP_PRIVATE, file, 0);
+		if (mapped == MAP_FAILED)
+		{
+			close(file);
+			throw std::runtime_error("Could not map " + path);
+		}
+		m_Data = static_cast<uint8_t*>(mapped);
+	}
+
+	// The mapping keeps its own reference to the file
+	close(file);
+}
+
+mapped_file::~mapped_file()
+{
+	if (m_Data != nullptr)
+	{
+		munmap(m_Data, m_Size);
+	}
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Maps a whole file into memory
+// Read only maps can be shared between processes. Copy on write maps can be changed freely,
+// pages are only copied when first written and the file itself is never changed
+class mapped_file
+{
+public:
+	enum class access
+	{
+		read_only,
+		copy_on_write,
+	};
+
+	// Throws std::runtime_error if the file can't be opened or mapped. An empty file maps to nullptr
+	explicit mapped_file(const std::string& path, access mode = access::read_only);
+
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	const uint8_t* data() const { return m_Data; }
+	// Only writable with copy_on_write
+	uint8_t* data() { return m_Data; }
+	size_t size() const { return m_Size; }
+
+private:
+	uint8_t*	m_Data = nullptr;
+	size_t		m_Size = 0u;
+
+	// Windows handles. Unused on POSIX where the mapping keeps the file alive by itself
+	void*		m_File = nullptr;
+	void*		m_Mapping = nullptr;
+};
@@ -0,0 +1,80 @@
+#include "numa_placement.hpp"
+
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+bool pin_current_thread(uint32_t cpuIndex)
+{
+#ifdef _WIN32
+	DWORD_PTR processMask, systemMask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) || processMask == 0u)
+	{
+		return false;
+	}
+
+	std::vector<DWORD_PTR> cpus;
+	for (auto bit = 0u; bit < sizeof(DWORD_PTR) * 8u; ++bit)
+	{
+		if (processMask & (static_cast<DWORD_PTR>(1u) << bit))
+		{
+			cpus.push_back(static_cast<DWORD_PTR>(1u) << bit);
+		}
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), cpus[cpuIndex % cpus.size()]) != 0u;
+#else
+	// Whatever the process was started with, so taskset and friends still choose which CPUs are used
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+	{
+		return false;
+	}
+
+	std::vector<int> cpus;
+	for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	{
+		if (CPU_ISSET(cpu, &allowed))
+		{
+			cpus.push_back(cpu);
+		}
+	}
+
+	cpu_set_t pinned;
+	CPU_ZERO(&pinned);
+	CPU_SET(cpus[cpuIndex % cpus.size()], &pinned);
+	return pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned) == 0;
+#endif
+}
+
+size_t page_size()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+void touch_pages_interleaved(void* memory, size_t bytes, size_t pageSize, uint32_t part, uint32_t numParts)
+{
+	auto* bytePointer = static_cast<volatile char*>(memory);
+
+	// Memory might not start on a page boundary. The page it starts in goes to whoever has page 0
+	const auto offset = reinterpret_cast<uintptr_t>(memory) % pageSize;
+	const auto stride = pageSize * numParts;
+	for (size_t page = static_cast<size_t>(part) * pageSize; page < bytes + offset; page += stride)
+	{
+		bytePointer[page > offset ? page - offset : 0u] = 0;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Helpers for keeping threads and the memory they use on the same NUMA node without a NUMA library
+// Memory is placed on the node of the thread that first writes each page, so choosing who touches what first
+// decides where it lives. Only works on memory that hasn't been written yet (e.g. fresh arena blocks)
+
+// Pins the calling thread to one CPU. Index wraps round the CPUs this process is allowed on, in order
+// False if the OS refused
+bool pin_current_thread(uint32_t cpuIndex);
+
+// Size of a normal page
+size_t page_size();
+
+// Writes a byte to every numParts'th page of [memory, memory + bytes), starting from page part
+// With one part per pinned thread the pages are dealt out round robin between their nodes
+void touch_pages_interleaved(void* memory, size_t bytes, size_t pageSize, uint32_t part, uint32_t numParts);
@@ -0,0 +1,227 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace profiler
+{
+	namespace
+	{
+		struct zone_info
+		{
+			const char*	name = nullptr;
+			zone_id		parent = ROOT_ZONE;
+		};
+
+		// Totals of one thread, indexed by zone. Kept alive by the registry after the thread exits so nothing it timed is lost
+		struct thread_totals
+		{
+			std::vector<ticks>		time;
+			std::vector<uint32_t>	calls;
+		};
+
+		// Every zone and every thread that has timed something
+		std::mutex g_Lock;
+		std::vector<zone_info> g_Zones(1u);
+		std::vector<std::shared_ptr<thread_totals>> g_Threads;
+
+		struct thread_state
+		{
+			std::shared_ptr<thread_totals> totals;
+			zone_id current = ROOT_ZONE;
+			// Children of each zone this thread has looked up before, so it only takes the lock for new ones
+			std::vector<std::vector<std::pair<const char*, zone_id>>> children;
+		};
+
+		thread_state& this_thread()
+		{
+			thread_local thread_state state;
+			if (!state.totals)
+			{
+				// So it's never measured while something is being timed
+				ticks_per_second();
+
+				state.totals = std::make_shared<thread_totals>();
+				std::lock_guard<std::mutex> lock(g_Lock);
+				g_Threads.push_back(state.totals);
+			}
+			return state;
+		}
+
+		// Zones first, then each one's children in the order they were made
+		void write_zone(std::ostream& out, const std::vector<zone_info>& zones, const std::vector<std::vector<zone_id>>& children,
+			const std::vector<ticks>& time, const std::vector<ticks>& longest, const std::vector<uint32_t>& calls, const std::vector<uint32_t>& threads,
+			zone_id zone, uint32_t depth)
+		{
+			if (calls[zone] == 0u)
+			{
+				return;
+			}
+
+			const auto milliseconds = [](ticks t) { return 1000.0 * static_cast<double>(t) / ticks_per_second(); };
+			const auto indent = std::string(depth * 2u, ' ');
+			out << '\t' << indent << std::left << std::setw(static_cast<int>(std::max<size_t>(28u - indent.size(), 1u))) << zones[zone].name << std::right
+				<< std::setw(12) << milliseconds(time[zone]) << " ms";
+			if (threads[zone] > 1u)
+			{
+				out << "  " << threads[zone] << " threads, longest " << milliseconds(longest[zone]) << " ms";
+			}
+			out << "  " << calls[zone] << (calls[zone] == 1u ? " call\n" : " calls\n");
+
+			for (const auto child : children[zone])
+			{
+				write_zone(out, zones, children, time, longest, calls, threads, child, depth + 1u);
+			}
+		}
+	}
+
+	double ticks_per_second()
+	{
+		#ifdef PROFILER_USE_TSC
+		static const double rate = []
+		{
+			// Long enough that the few cycles either side of each clock read don't matter
+			const auto steadyStart = std::chrono::steady_clock::now();
+			const auto start = now();
+			auto steadyEnd = steadyStart;
+			while (steadyEnd - steadyStart < std::chrono::milliseconds(10))
+			{
+				steadyEnd = std::chrono::steady_clock::now();
+			}
+			const auto end = now();
+			return static_cast<double>(end - start) / std::chrono::duration<double>(steadyEnd - steadyStart).count();
+		}();
+		return rate;
+		#else
+		return 1000000000.0;
+		#endif
+	}
+
+	zone_id child_zone(zone_id parent, const char* name)
+	{
+		auto& state = this_thread();
+		if (state.children.size() <= parent)
+		{
+			state.children.resize(parent + 1u);
+		}
+		for (const auto& child : state.children[parent])
+		{
+			if (child.first == name)
+			{
+				return child.second;
+			}
+		}
+
+		// The same name can be at a different address in another translation unit, so compare the text
+		zone_id id = ROOT_ZONE;
+		{
+			std::lock_guard<std::mutex> lock(g_Lock);
+			for (zone_id z = 1u; z < g_Zones.size(); ++z)
+			{
+				if (g_Zones[z].parent == parent && std::strcmp(g_Zones[z].name, name) == 0)
+				{
+					id = z;
+					break;
+				}
+			}
+			if (id == ROOT_ZONE)
+			{
+				id = static_cast<zone_id>(g_Zones.size());
+				g_Zones.push_back({ name, parent });
+			}
+		}
+
+		state.children[parent].emplace_back(name, id);
+		return id;
+	}
+
+	zone_id current_zone()
+	{
+		return this_thread().current;
+	}
+
+	void add(zone_id zone, ticks elapsed, uint32_t calls)
+	{
+		auto& totals = *this_thread().totals;
+		if (totals.time.size() <= zone)
+		{
+			totals.time.resize(zone + 1u, 0u);
+			totals.calls.resize(zone + 1u, 0u);
+		}
+		totals.time[zone] += elapsed;
+		totals.calls[zone] += calls;
+	}
+
+	scoped_zone::scoped_zone(const char* name) : scoped_zone(current_zone(), name)
+	{
+	}
+
+	scoped_zone::scoped_zone(zone_id parent, const char* name) : m_Id(child_zone(parent, name))
+	{
+		auto& state = this_thread();
+		m_Previous = state.current;
+		state.current = m_Id;
+		m_Start = now();
+	}
+
+	void scoped_zone::end()
+	{
+		if (!m_Open)
+		{
+			return;
+		}
+		m_Open = false;
+
+		add(m_Id, now() - m_Start);
+		this_thread().current = m_Previous;
+	}
+
+	void report(std::ostream& out)
+	{
+		std::lock_guard<std::mutex> lock(g_Lock);
+
+		const auto numZones = g_Zones.size();
+		std::vector<ticks> time(numZones, 0u);
+		std::vector<ticks> longest(numZones, 0u);
+		std::vector<uint32_t> calls(numZones, 0u);
+		std::vector<uint32_t> threads(numZones, 0u);
+		for (auto& thread : g_Threads)
+		{
+			for (size_t z = 0u; z < thread->time.size(); ++z)
+			{
+				if (thread->calls[z] != 0u)
+				{
+					time[z] += thread->time[z];
+					longest[z] = std::max(longest[z], thread->time[z]);
+					calls[z] += thread->calls[z];
+					++threads[z];
+				}
+			}
+			std::fill(thread->time.begin(), thread->time.end(), 0u);
+			std::fill(thread->calls.begin(), thread->calls.end(), 0u);
+		}
+
+		// Parents always come before their children
+		std::vector<std::vector<zone_id>> children(numZones);
+		for (zone_id z = 1u; z < numZones; ++z)
+		{
+			children[g_Zones[z].parent].push_back(z);
+		}
+
+		const auto flags = out.flags();
+		const auto precision = out.precision();
+		out << std::fixed << std::setprecision(3);
+		for (const auto zone : children[ROOT_ZONE])
+		{
+			write_zone(out, g_Zones, children, time, longest, calls, threads, zone, 0u);
+		}
+		out.flags(flags);
+		out.precision(precision);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TSC
+#endif
+
+// Times nested regions of code (zones) on any number of threads and prints them as a tree
+//
+// A zone is a name under a parent zone. Each one gets an id shared by every thread, so the same region timed on several
+// threads (e.g. each threads share of a phase) adds up into one entry. Threads keep their own totals so timing never
+// takes a lock, except the first time a thread meets a zone
+//
+// Names are kept by pointer so must live forever, e.g. string literals
+//
+// On x86 zones are timed with the time stamp counter, which is about half the cost of steady_clock to read. It is measured
+// against steady_clock once, so assumes the counter runs at a constant rate on every core, as it does on any recent CPU
+namespace profiler
+{
+	typedef uint32_t zone_id;
+	// Time stamp counter cycles, or nanoseconds where there isn't one
+	typedef uint64_t ticks;
+
+	// Parent of every top level zone
+	const zone_id ROOT_ZONE = 0u;
+
+	inline ticks now()
+	{
+		#ifdef PROFILER_USE_TSC
+		return static_cast<ticks>(__rdtsc());
+		#else
+		return static_cast<ticks>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+		#endif
+	}
+
+	// How many ticks there are in a second. Measured the first time it's needed, which takes a few milliseconds
+	double ticks_per_second();
+
+	// For times taken from steady_clock, e.g. by the thread pool
+	inline ticks to_ticks(std::chrono::steady_clock::duration duration)
+	{
+		return static_cast<ticks>(std::chrono::duration<double>(duration).count() * ticks_per_second());
+	}
+
+	// The zone called name under parent, made the first time any thread asks for it
+	zone_id child_zone(zone_id parent, const char* name);
+
+	// Zone the calling thread is timing, or ROOT_ZONE
+	zone_id current_zone();
+
+	// Time measured by hand on the calling thread, e.g. summed over a loop where a scoped_zone per pass would cost too much
+	void add(zone_id zone, ticks elapsed, uint32_t calls = 1u);
+
+	// Times from construction to end() or destruction. Zones made on this thread while it's open go under it
+	class scoped_zone
+	{
+	public:
+		// Under the zone this thread is timing
+		explicit scoped_zone(const char* name);
+		// Under a zone another thread is timing, e.g. the phase a thread pool job is part of
+		scoped_zone(zone_id parent, const char* name);
+
+		~scoped_zone() { end(); }
+
+		scoped_zone(const scoped_zone&) = delete;
+		scoped_zone& operator=(const scoped_zone&) = delete;
+
+		// Stops timing early. Does nothing the second time
+		void end();
+
+		zone_id id() const { return m_Id; }
+
+	private:
+		zone_id	m_Id;
+		zone_id	m_Previous;
+		ticks	m_Start;
+		bool	m_Open = true;
+	};
+
+	// Writes every zone timed since the last report as an indented tree, then starts again from zero
+	// Times on several threads are added together, with the longest single thread alongside
+	// Only call while no other thread is timing anything, e.g. between frames
+	void report(std::ostream& out);
+}
@@ -0,0 +1,77 @@
+#include "shared_memory.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+shared_memory::shared_memory(size_t size) : m_Size(size)
+{
+	// Backed by the page file and unnamed, so it goes when the last handle does
+	const auto bytes = static_cast<unsigned long long>(size);
+	m_Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), nullptr);
+	if (m_Mapping != nullptr)
+	{
+		m_Data = static_cast<uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+	}
+	if (m_Data == nullptr)
+	{
+		if (m_Mapping != nullptr)
+		{
+			CloseHandle(m_Mapping);
+		}
+		throw std::runtime_error("Could not make " + std::to_string(size) + " bytes of shared memory");
+	}
+}
+
+shared_memory::~shared_memory()
+{
+	UnmapViewOfFile(m_Data);
+	CloseHandle(m_Mapping);
+}
+
+#else
+
+shared_memory::shared_memory(size_t size) : m_Size(size)
+{
+	// The name is removed as soon as it's mapped. Forked children inherit the mapping rather than opening it by name
+	const auto name = "/multithreading_visualiser_" + std::to_string(getpid());
+	const auto file = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (file < 0)
+	{
+		throw std::runtime_error("Could not open shared memory " + name);
+	}
+	shm_unlink(name.c_str());
+
+	// New shared memory reads as zeros
+	if (ftruncate(file, static_cast<off_t>(size)) != 0)
+	{
+		close(file);
+		throw std::runtime_error("Could not make " + std::to_string(size) + " bytes of shared memory");
+	}
+
+	const auto mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (mapped == MAP_FAILED)
+	{
+		throw std::runtime_error("Could not map " + std::to_string(size) + " bytes of shared memory");
+	}
+	m_Data = static_cast<uint8_t*>(mapped);
+}
+
+shared_memory::~shared_memory()
+{
+	munmap(m_Data, m_Size);
+}
+
+#endif
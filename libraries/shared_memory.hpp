@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Zeroed block of memory shared with any child process forked after it is made
+// Nothing is left behind when the processes exit, however they exit
+class shared_memory
+{
+public:
+	// Throws std::runtime_error if the memory can't be made
+	explicit shared_memory(size_t size);
+
+	~shared_memory();
+
+	shared_memory(const shared_memory&) = delete;
+	shared_memory& operator=(const shared_memory&) = delete;
+
+	uint8_t* data() { return m_Data; }
+	const uint8_t* data() const { return m_Data; }
+	size_t size() const { return m_Size; }
+
+private:
+	uint8_t*	m_Data = nullptr;
+	size_t		m_Size = 0u;
+
+	// Windows handle. Unused on POSIX where the mapping keeps the memory alive by itself
+	void*		m_Mapping = nullptr;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Fixed size lock-free queue for exactly one producer thread and one consumer thread
+// Each side keeps a private copy of the other sides index and only re-reads the shared one when that copy says
+// the queue is full/empty, so in steady state the two threads don't bounce cache lines between them
+template <typename T>
+class spsc_ring
+{
+public:
+	// Capacity is rounded up to a power of two
+	explicit spsc_ring(size_t capacity) : m_Items(round_up_pow2(capacity)), m_Mask(m_Items.size() - 1u)
+	{
+	}
+
+	spsc_ring(const spsc_ring&) = delete;
+	spsc_ring& operator=(const spsc_ring&) = delete;
+
+	// Producer only. False if the queue is full
+	bool try_push(const T& item)
+	{
+		const auto tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail - m_CachedHead == m_Items.size())
+		{
+			m_CachedHead = m_Head.load(std::memory_order_acquire);
+			if (tail - m_CachedHead == m_Items.size())
+			{
+				return false;
+			}
+		}
+
+		m_Items[tail & m_Mask] = item;
+		m_Tail.store(tail + 1u, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only. Pops up to maxItems into out and returns how many
+	size_t try_pop(T* out, size_t maxItems)
+	{
+		const auto head = m_Head.load(std::memory_order_relaxed);
+		if (head == m_CachedTail)
+		{
+			m_CachedTail = m_Tail.load(std::memory_order_acquire);
+			if (head == m_CachedTail)
+			{
+				return 0u;
+			}
+		}
+
+		const auto available = m_CachedTail - head;
+		const auto count = available < maxItems ? available : maxItems;
+		for (size_t i = 0u; i < count; ++i)
+		{
+			out[i] = m_Items[(head + i) & m_Mask];
+		}
+
+		m_Head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+	size_t capacity() const { return m_Items.size(); }
+
+private:
+	static size_t round_up_pow2(size_t value)
+	{
+		size_t pow2 = 1u;
+		while (pow2 < value)
+		{
+			pow2 <<= 1u;
+		}
+		return pow2;
+	}
+
+	std::vector<T> m_Items;
+	const size_t m_Mask;
+
+	// Consumer side. Next item to pop and the last tail it saw
+	alignas(64) std::atomic<size_t> m_Head = { 0u };
+	size_t m_CachedTail = 0u;
+
+	// Producer side. Next slot to push to and the last head it saw
+	alignas(64) std::atomic<size_t> m_Tail = { 0u };
+	size_t m_CachedHead = 0u;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+
+// Stopwatch with a lap timer on std::chrono::steady_clock, so it needs nothing but the standard library
+// Start and stop don't reset the count, reset does. Lap times don't affect the main count
+class steady_timer
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	explicit steady_timer(bool running = true) : m_Running(running)
+	{
+		reset();
+	}
+
+	// Carries on counting from where it stopped. Time spent stopped is skipped, by the lap too
+	void start()
+	{
+		if (!m_Running)
+		{
+			const auto stopped = clock::now() - m_StopTime;
+			m_StartTime += stopped;
+			m_LapStartTime += stopped;
+			m_Running = true;
+		}
+	}
+
+	void stop()
+	{
+		if (m_Running)
+		{
+			m_StopTime = clock::now();
+			m_Running = false;
+		}
+	}
+
+	// Back to zero and starts a new lap. Doesn't start or stop it
+	void reset()
+	{
+		m_StartTime = clock::now();
+		m_LapStartTime = m_StartTime;
+		m_StopTime = m_StartTime;
+	}
+
+	// Seconds counted since the last reset
+	float time() const
+	{
+		return seconds(current() - m_StartTime);
+	}
+
+	// Seconds counted in the current lap, then starts a new one
+	float lap_time()
+	{
+		const auto now = current();
+		const auto lap = seconds(now - m_LapStartTime);
+		m_LapStartTime = now;
+		return lap;
+	}
+
+	bool running() const { return m_Running; }
+
+private:
+	clock::time_point current() const { return m_Running ? clock::now() : m_StopTime; }
+
+	static float seconds(clock::duration duration) { return std::chrono::duration<float>(duration).count(); }
+
+	clock::time_point m_StartTime;
+	clock::time_point m_LapStartTime;
+	clock::time_point m_StopTime;
+	bool m_Running;
+};
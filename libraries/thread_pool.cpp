@@ -0,0 +1,135 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define THREAD_POOL_PAUSE() _mm_pause()
+#else
+#define THREAD_POOL_PAUSE() std::this_thread::yield()
+#endif
+
+thread_pool::thread_pool(uint32_t numWorkers, uint32_t spinCount) : m_Workers(numWorkers), m_SpinCount(spinCount)
+{
+	for (auto i = 0u; i < numWorkers; ++i)
+	{
+		m_Workers[i].thread = std::thread(&thread_pool::worker_loop, this, i);
+	}
+}
+
+thread_pool::~thread_pool()
+{
+	// Bumping the generation gets spinning workers out of their loop, the notify gets the parked ones
+	m_Shutdown.store(true);
+	m_Generation.fetch_add(1u);
+	{
+		std::unique_lock<std::mutex> l(m_DispatchLock);
+	}
+	m_DispatchReady.notify_all();
+
+	for (auto& worker : m_Workers)
+	{
+		worker.thread.join();
+	}
+}
+
+void thread_pool::run(const job& task)
+{
+	m_DispatchTime = clock::now();
+
+	m_Job = &task;
+	m_Remaining.store(num_workers());
+
+	// Dispatch. Only take the lock if someone might be parked
+	// Worker bumps m_ParkedWorkers before it checks the generation, so either it sees this generation or we see it parked
+	m_Generation.fetch_add(1u);
+	if (m_ParkedWorkers.load() > 0u)
+	{
+		{
+			std::unique_lock<std::mutex> l(m_DispatchLock);
+		}
+		m_DispatchReady.notify_all();
+	}
+
+	// Do our share
+	run_job(num_workers());
+
+	// Join. Spin first as the workers are normally close behind
+	for (auto spin = 0u; m_Remaining.load() != 0u && spin < m_SpinCount; ++spin)
+	{
+		THREAD_POOL_PAUSE();
+	}
+	if (m_Remaining.load() != 0u)
+	{
+		std::unique_lock<std::mutex> l(m_JoinLock);
+		m_CallerParked.store(true);
+		m_JoinReady.wait(l, [&]() { return m_Remaining.load() == 0u; });
+		m_CallerParked.store(false);
+	}
+
+	m_JoinTime = clock::now();
+	const auto wallTime = std::chrono::duration<double>(m_JoinTime - m_DispatchTime).count();
+
+	double longestJob = 0.0;
+	for (auto i = 0u; i < num_threads(); ++i)
+	{
+		const auto& times = job_times_for(i);
+		longestJob = std::max(longestJob, std::chrono::duration<double>(times.end - times.start).count());
+	}
+	m_ComputeTime += longestJob;
+	m_OverheadTime += std::max(wallTime - longestJob, 0.0);
+}
+
+void thread_pool::reset_times()
+{
+	m_ComputeTime = 0.0;
+	m_OverheadTime = 0.0;
+}
+
+void thread_pool::worker_loop(uint32_t threadIndex)
+{
+	uint64_t seenGeneration = 0u;
+
+	while (true)
+	{
+		// Wait for the generation to move on
+		auto spin = 0u;
+		while (m_Generation.load() == seenGeneration && spin++ < m_SpinCount)
+		{
+			THREAD_POOL_PAUSE();
+		}
+		if (m_Generation.load() == seenGeneration)
+		{
+			std::unique_lock<std::mutex> l(m_DispatchLock);
+			m_ParkedWorkers.fetch_add(1u);
+			m_DispatchReady.wait(l, [&]() { return m_Generation.load() != seenGeneration; });
+			m_ParkedWorkers.fetch_sub(1u);
+		}
+		seenGeneration = m_Generation.load();
+
+		if (m_Shutdown.load())
+		{
+			return;
+		}
+
+		run_job(threadIndex);
+
+		// Last one out wakes the caller if it gave up spinning
+		if (m_Remaining.fetch_sub(1u) == 1u && m_CallerParked.load())
+		{
+			{
+				std::unique_lock<std::mutex> l(m_JoinLock);
+			}
+			m_JoinReady.notify_one();
+		}
+	}
+}
+
+void thread_pool::run_job(uint32_t threadIndex)
+{
+	auto& times = job_times_for(threadIndex);
+	times.start = clock::now();
+	(*m_Job)(threadIndex);
+	times.end = clock::now();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads that all run the same job at once, with the calling thread taking part as the last index
+// Made for running a frame as a handful of phases. Each run() is a dispatch barrier then a join barrier
+//
+// Both barriers spin for a while before parking on a condition variable
+// Phases usually follow each other closely so spinning avoids a kernel round trip per phase,
+// but threads still sleep properly when the caller stops dispatching (e.g. paused)
+class thread_pool
+{
+public:
+	// Job is given the index of the thread running it. Workers are 0 to num_workers() - 1, the calling thread is num_workers()
+	typedef std::function<void(uint32_t)> job;
+	typedef std::chrono::steady_clock clock;
+
+	// How many times a thread checks before parking. Roughly tens of microseconds
+	static const uint32_t DEFAULT_SPIN_COUNT = 20000u;
+
+	thread_pool(uint32_t numWorkers, uint32_t spinCount = DEFAULT_SPIN_COUNT);
+
+	// Tells the workers to stop and joins them
+	~thread_pool();
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	// Runs the job on every worker and the calling thread. Returns once they have all finished
+	void run(const job& task);
+
+	uint32_t num_workers() const { return static_cast<uint32_t>(m_Workers.size()); }
+	uint32_t num_threads() const { return num_workers() + 1u; }
+
+	// Time spent in run() since the last reset, split into the longest job on any thread and everything else
+	// Overhead is waking the workers, waiting for the last one to finish and noticing it has
+	double compute_time() const { return m_ComputeTime; }
+	double overhead_time() const { return m_OverheadTime; }
+	void reset_times();
+
+	// Timeline of the last run(). Dispatch is when it started waking workers, join is when it saw the last one finish
+	// Between the two each thread started and finished its job, so start - dispatch is how long it took to wake
+	// and join - end is how long it sat idle at the barrier
+	clock::time_point last_dispatch_time() const { return m_DispatchTime; }
+	clock::time_point last_join_time() const { return m_JoinTime; }
+	clock::time_point job_start_time(uint32_t threadIndex) const { return job_times_for(threadIndex).start; }
+	clock::time_point job_end_time(uint32_t threadIndex) const { return job_times_for(threadIndex).end; }
+
+private:
+	// When a thread started and finished its job in the last run
+	struct job_times
+	{
+		clock::time_point start;
+		clock::time_point end;
+	};
+
+	// Each worker has its own cache line so workers writing their state never slow each other down
+	struct alignas(64) worker_state
+	{
+		std::thread	thread;
+		job_times	times;
+	};
+
+	void worker_loop(uint32_t threadIndex);
+
+	// Runs the job on this thread and records when it started and finished
+	void run_job(uint32_t threadIndex);
+
+	job_times& job_times_for(uint32_t threadIndex) { return threadIndex < num_workers() ? m_Workers[threadIndex].times : m_CallerTimes; }
+	const job_times& job_times_for(uint32_t threadIndex) const { return threadIndex < num_workers() ? m_Workers[threadIndex].times : m_CallerTimes; }
+
+	std::vector<worker_state> m_Workers;
+	job_times m_CallerTimes;
+	const uint32_t m_SpinCount;
+
+	// Job for the current run. Only changed while every worker is idle
+	const job* m_Job = nullptr;
+
+	// Dispatch. Bumped once per run, workers run the job when it changes
+	alignas(64) std::atomic<uint64_t> m_Generation = { 0u };
+	std::atomic<uint32_t> m_ParkedWorkers = { 0u };
+	std::atomic<bool> m_Shutdown = { false };
+	std::mutex m_DispatchLock;
+	std::condition_variable m_DispatchReady;
+
+	// Join. Workers count down as they finish, the last one wakes the caller if it has parked
+	alignas(64) std::atomic<uint32_t> m_Remaining = { 0u };
+	std::atomic<bool> m_CallerParked = { false };
+	std::mutex m_JoinLock;
+	std::condition_variable m_JoinReady;
+
+	clock::time_point m_DispatchTime;
+	clock::time_point m_JoinTime;
+
+	double m_ComputeTime = 0.0;
+	double m_OverheadTime = 0.0;
+};
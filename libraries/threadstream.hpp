@@ -42,11 +42,13 @@ public:
         os_ << this->str();
     }
 
+    // Held while a line is written. Anything else writing to the same streams takes it too so lines never tear
+    static std::mutex& mutex() { return _mutex_threadstream; }
+
 private:
-    static std::mutex _mutex_threadstream;
+    // Inline so any number of files can include this and still share the one mutex
+    static inline std::mutex _mutex_threadstream{};
     std::ostream& os_;
 };
 
-std::mutex ThreadStream::_mutex_threadstream{};
-
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Three copies of a value shared by exactly one producer thread and one consumer thread, neither of which ever waits
+// The producer fills the back copy and publishes it by swapping it with the spare. The consumer swaps its front copy
+// with the spare whenever a newer one has been published. Values the consumer was too slow to take are overwritten,
+// so it always sees the latest one
+template <typename T>
+class triple_buffer
+{
+public:
+	triple_buffer() = default;
+
+	triple_buffer(const triple_buffer&) = delete;
+	triple_buffer& operator=(const triple_buffer&) = delete;
+
+	// Producer only. Copy being filled. Its old contents are whatever was published two or more times ago
+	T& back() { return m_Buffers[m_Back]; }
+
+	// Producer only. Hands back() to the consumer and starts filling another copy
+	void publish()
+	{
+		m_Back = m_Spare.exchange(m_Back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Consumer only. Swaps in the latest published copy if there is one the consumer hasn't seen. False if not
+	bool update()
+	{
+		if ((m_Spare.load(std::memory_order_relaxed) & FRESH_BIT) == 0u)
+		{
+			return false;
+		}
+
+		m_Front = m_Spare.exchange(m_Front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	// Consumer only. Copy last taken by update(). Stays the same until the next update() that returns true
+	const T& front() const { return m_Buffers[m_Front]; }
+	T& front() { return m_Buffers[m_Front]; }
+
+	// Either side, but only while the other isn't using the buffer (e.g. to size every copy before starting)
+	T& buffer(uint32_t index) { return m_Buffers[index]; }
+
+private:
+	// Spare index in the low bits, plus a flag set when it holds a copy published since the consumer last took one
+	static const uint32_t INDEX_MASK = 3u;
+	static const uint32_t FRESH_BIT = 4u;
+
+	T m_Buffers[3];
+
+	// Producer side
+	alignas(64) uint32_t m_Back = 0u;
+	// Shared
+	alignas(64) std::atomic<uint32_t> m_Spare = { 1u };
+	// Consumer side
+	alignas(64) uint32_t m_Front = 2u;
+};
@@ -3,11 +3,20 @@
 
 #include "simulator.hpp"
 
-int main()
+int main(int argc, char* argv[])
 {
 	try
 	{
-		std::unique_ptr<simulator> mySim = std::make_unique<simulator>();
+		// e.g. MultithreadingVisualiser.exe --circles 4000000 --threads 64 --config run.cfg
+		const auto config = simulation_config::from_command_line(argc, argv);
+
+#ifdef _MULTI_PROCESS_
+		// Forks the other ranks. Each carries on from here in its own process with its own slab
+		slab_ranks ranks(config);
+		std::unique_ptr<simulator> mySim = std::make_unique<simulator>(ranks.rank_config(), ranks);
+#else
+		std::unique_ptr<simulator> mySim = std::make_unique<simulator>(config);
+#endif
 
 		mySim->run();
 	}
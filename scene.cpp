@@ -0,0 +1,378 @@
+#include "scene.hpp"
+
+#include "libraries/counter_rng.hpp"
+#include "libraries/numa_placement.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Every random field has its own stream. The circles index is the counter, so a circle gets the same
+	// numbers whichever thread makes it
+	enum class scene_stream : uint32_t
+	{
+		stationary_x,
+		stationary_y,
+		stationary_radius,
+		stationary_color,
+		moving_x,
+		moving_y,
+		moving_velocity_x,
+		moving_velocity_y,
+		moving_radius,
+		moving_color,
+	};
+
+	counter_rng scene_rng(const simulation_config& config, scene_stream stream)
+	{
+		return counter_rng(config.seed, static_cast<uint32_t>(stream));
+	}
+
+	float uniform(const counter_rng& rng, size_t index, const Vector2f& range)
+	{
+		return rng.uniform(index, range.x(), range.y());
+	}
+
+	circle_color random_color(const counter_rng& rng, size_t index)
+	{
+		// Three numbers per circle
+		circle_color color;
+		color.r = rng.uniform(index * 3u, 0.0f, 1.0f);
+		color.g = rng.uniform(index * 3u + 1u, 0.0f, 1.0f);
+		color.b = rng.uniform(index * 3u + 2u, 0.0f, 1.0f);
+		return color;
+	}
+
+	float random_radius(const counter_rng& rng, size_t index, const simulation_config& config)
+	{
+#ifdef _RANDOM_RADIUS_
+		return uniform(rng, index, config.radiusRange);
+#else
+		(void)rng;
+		(void)index;
+		(void)config;
+		return 1.0f;
+#endif
+	}
+
+	// Fastest a moving circle can start out going
+	float max_speed(const simulation_config& config)
+	{
+		const auto largest = [](const Vector2f& range) { return std::max(std::abs(range.x()), std::abs(range.y())); };
+		return std::hypot(largest(config.xVelocityRange), largest(config.yVelocityRange));
+	}
+
+	// Splits count items evenly between every thread in the pool
+	void thread_range(const thread_pool& pool, uint32_t threadIndex, size_t count, size_t& begin, size_t& end)
+	{
+		const uint64_t numThreads = pool.num_threads();
+		begin = static_cast<size_t>(count * static_cast<uint64_t>(threadIndex) / numThreads);
+		end = static_cast<size_t>(count * static_cast<uint64_t>(threadIndex + 1u) / numThreads);
+	}
+
+	// Position of a stationary circle in spawn order. Sorted by value so the sort never chases indexes
+	struct sort_entry
+	{
+		float		x;
+		uint32_t	index;
+	};
+
+	// Order that sorts x ascending. Each thread sorts its own range then neighbouring runs are merged in parallel
+	// Ties are broken by index so there is exactly one right answer, whatever the thread count
+	std::vector<sort_entry> parallel_sort_order(thread_pool& pool, const std::vector<float>& x)
+	{
+		const auto count = x.size();
+		const auto numThreads = pool.num_threads();
+		const auto less = [](const sort_entry& a, const sort_entry& b)
+		{
+			return a.x < b.x || (a.x == b.x && a.index < b.index);
+		};
+
+		std::vector<sort_entry> order(count);
+		std::vector<sort_entry> scratch(count);
+		std::vector<size_t> runStarts(static_cast<size_t>(numThreads) + 1u);
+		for (auto i = 0u; i < numThreads; ++i)
+		{
+			size_t end;
+			thread_range(pool, i, count, runStarts[i], end);
+		}
+		runStarts[numThreads] = count;
+
+		pool.run([&](uint32_t threadIndex)
+		{
+			for (auto i = runStarts[threadIndex]; i < runStarts[threadIndex + 1u]; ++i)
+			{
+				order[i] = sort_entry{ x[i], static_cast<uint32_t>(i) };
+			}
+			std::sort(order.begin() + static_cast<std::ptrdiff_t>(runStarts[threadIndex]), order.begin() + static_cast<std::ptrdiff_t>(runStarts[threadIndex + 1u]), less);
+		});
+
+		// Halve the number of runs each pass. A run without a partner is just copied across
+		auto numRuns = runStarts.size() - 1u;
+		while (numRuns > 1u)
+		{
+			const auto numMerged = (numRuns + 1u) / 2u;
+			pool.run([&](uint32_t threadIndex)
+			{
+				for (size_t merge = threadIndex; merge < numMerged; merge += numThreads)
+				{
+					const auto first = runStarts[2u * merge];
+					const auto middle = runStarts[std::min(2u * merge + 1u, numRuns)];
+					const auto last = runStarts[std::min(2u * merge + 2u, numRuns)];
+					std::merge(order.begin() + static_cast<std::ptrdiff_t>(first), order.begin() + static_cast<std::ptrdiff_t>(middle),
+						order.begin() + static_cast<std::ptrdiff_t>(middle), order.begin() + static_cast<std::ptrdiff_t>(last),
+						scratch.begin() + static_cast<std::ptrdiff_t>(first), less);
+				}
+			});
+			std::swap(order, scratch);
+
+			std::vector<size_t> mergedStarts;
+			for (size_t merge = 0u; merge < numMerged; ++merge)
+			{
+				mergedStarts.push_back(runStarts[2u * merge]);
+			}
+			mergedStarts.push_back(count);
+			runStarts.swap(mergedStarts);
+			numRuns = numMerged;
+		}
+
+		return order;
+	}
+
+	// Pages interleave_pages deals out
+	size_t interleave_page_size(const simulation_config& config)
+	{
+		return config.hugePages == aligned_arena::page_mode::normal ? page_size() : aligned_arena::HUGE_PAGE_SIZE;
+	}
+
+	// Every array the collision loop reads for stationary circles
+	void interleave_stationary(const simulation_config& config, thread_pool& pool, stationary_collision_array& sColData)
+	{
+		const auto count = sColData.size();
+		interleave_pages(config, pool, sColData.x, count * sizeof(float));
+		interleave_pages(config, pool, sColData.y, count * sizeof(float));
+		interleave_pages(config, pool, sColData.radius, count * sizeof(float));
+		interleave_pages(config, pool, sColData.uniqueIndex, count * sizeof(uint32_t));
+	}
+}
+
+size_t interleave_alignment(const simulation_config& config)
+{
+	return config.interleaveStationary ? interleave_page_size(config) : 0u;
+}
+
+void interleave_pages(const simulation_config& config, thread_pool& pool, void* memory, size_t bytes)
+{
+	const auto pageSize = interleave_page_size(config);
+	pool.run([&](uint32_t threadIndex)
+	{
+		touch_pages_interleaved(memory, bytes, pageSize, threadIndex, pool.num_threads());
+	});
+}
+
+void generate_scene(const simulation_config& config, thread_pool& pool, aligned_arena& arena,
+	stationary_collision_array& sColData, stationary_unique_array& sUniqueArray,
+	moving_collision_array& mColData, moving_unique_array& mUniqueArray)
+{
+	const auto numStationary = config.numStationaryCircles;
+	const auto numMoving = config.numMovingCircles;
+
+	// Everything sized by the scene is allocated up front
+	// Interleaved arrays get whole pages, so dealing them out never touches the moving arrays first_touch places
+	sColData.allocate(arena, numStationary, interleave_alignment(config));
+	sUniqueArray.allocate(arena, numStationary);
+	mColData.allocate(arena, numMoving);
+	mUniqueArray.allocate(arena, numMoving);
+
+	// Moving circles are always made in each threads own slice, which is what first_touch relies on
+	if (config.interleaveStationary)
+	{
+		interleave_stationary(config, pool, sColData);
+	}
+
+	const auto stationaryX = scene_rng(config, scene_stream::stationary_x);
+	const auto stationaryY = scene_rng(config, scene_stream::stationary_y);
+	const auto stationaryRadius = scene_rng(config, scene_stream::stationary_radius);
+	const auto stationaryColor = scene_rng(config, scene_stream::stationary_color);
+	const auto movingX = scene_rng(config, scene_stream::moving_x);
+	const auto movingY = scene_rng(config, scene_stream::moving_y);
+	const auto movingVelocityX = scene_rng(config, scene_stream::moving_velocity_x);
+	const auto movingVelocityY = scene_rng(config, scene_stream::moving_velocity_y);
+	const auto movingRadius = scene_rng(config, scene_stream::moving_radius);
+	const auto movingColor = scene_rng(config, scene_stream::moving_color);
+
+	// Stationary circles are made in spawn order then sorted by x to allow line sweep
+	std::vector<float> unsortedX(numStationary);
+	std::vector<float> unsortedY(numStationary);
+	std::vector<float> unsortedRadius(numStationary);
+
+	pool.run([&](uint32_t threadIndex)
+	{
+		size_t begin, end;
+		thread_range(pool, threadIndex, numStationary, begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			unsortedX[i] = uniform(stationaryX, i, config.xSpawnRange);
+			unsortedY[i] = uniform(stationaryY, i, config.ySpawnRange);
+			unsortedRadius[i] = random_radius(stationaryRadius, i, config);
+		}
+
+		thread_range(pool, threadIndex, numMoving, begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			mColData.x[i] = uniform(movingX, i, config.xSpawnRange);
+			mColData.y[i] = uniform(movingY, i, config.ySpawnRange);
+			mColData.velocityX[i] = uniform(movingVelocityX, i, config.xVelocityRange);
+			mColData.velocityY[i] = uniform(movingVelocityY, i, config.yVelocityRange);
+			mColData.radius[i] = random_radius(movingRadius, i, config);
+			mColData.hp[i] = 100;
+			mColData.id[i] = static_cast<uint32_t>(i);
+			mUniqueArray.color[i] = random_color(movingColor, i);
+		}
+	});
+
+	const auto sortedOrder = parallel_sort_order(pool, unsortedX);
+
+	// Gather into sorted order, then set up unique data for the sorted circles
+	pool.run([&](uint32_t threadIndex)
+	{
+		size_t begin, end;
+		thread_range(pool, threadIndex, numStationary, begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto from = sortedOrder[i].index;
+			sColData.x[i] = sortedOrder[i].x;
+			sColData.y[i] = unsortedY[from];
+			sColData.radius[i] = unsortedRadius[from];
+
+			sUniqueArray.color[i] = random_color(stationaryColor, i);
+			sColData.uniqueIndex[i] = static_cast<uint32_t>(i);
+		}
+	});
+}
+
+void generate_slab_scene(const simulation_config& config, thread_pool& pool, aligned_arena& arena, float slabLeft, float slabRight,
+	stationary_collision_array& sColData, stationary_unique_array& sUniqueArray, size_t& firstStationary,
+	moving_collision_array& mColData, moving_unique_array& mUniqueArray)
+{
+	const auto numStationary = config.numStationaryCircles;
+	const auto numMoving = config.numMovingCircles;
+	const auto numThreads = pool.num_threads();
+
+	// Any stationary circle a moving circle in the slab could touch once it has moved for a frame. Bounces keep the speed
+	// so it never gets further than that. Touching distance is doubled so rounding can never reach a circle that wasn't kept
+	const float halo = max_speed(config) * config.timeStep + 2.0f * config.max_collision_distance();
+	const float haloLeft = slabLeft - halo;
+	const float haloRight = slabRight + halo;
+
+	const auto stationaryX = scene_rng(config, scene_stream::stationary_x);
+	const auto stationaryY = scene_rng(config, scene_stream::stationary_y);
+	const auto stationaryRadius = scene_rng(config, scene_stream::stationary_radius);
+	const auto stationaryColor = scene_rng(config, scene_stream::stationary_color);
+	const auto movingX = scene_rng(config, scene_stream::moving_x);
+	const auto movingY = scene_rng(config, scene_stream::moving_y);
+	const auto movingVelocityX = scene_rng(config, scene_stream::moving_velocity_x);
+	const auto movingVelocityY = scene_rng(config, scene_stream::moving_velocity_y);
+	const auto movingRadius = scene_rng(config, scene_stream::moving_radius);
+	const auto movingColor = scene_rng(config, scene_stream::moving_color);
+
+	// Every x is made, but only what the slab needs is kept. Each thread keeps its share in spawn order
+	std::vector<std::vector<uint32_t>> keptStationary(numThreads);
+	std::vector<std::vector<uint32_t>> keptMoving(numThreads);
+	std::vector<size_t> stationaryBefore(numThreads);
+
+	pool.run([&](uint32_t threadIndex)
+	{
+		size_t begin, end;
+		thread_range(pool, threadIndex, numStationary, begin, end);
+		size_t before = 0u;
+		for (auto i = begin; i < end; ++i)
+		{
+			const float x = uniform(stationaryX, i, config.xSpawnRange);
+			if (x < haloLeft)
+			{
+				++before;
+			}
+			else if (x < haloRight)
+			{
+				keptStationary[threadIndex].push_back(static_cast<uint32_t>(i));
+			}
+		}
+		stationaryBefore[threadIndex] = before;
+
+		thread_range(pool, threadIndex, numMoving, begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			const float x = uniform(movingX, i, config.xSpawnRange);
+			if (slabLeft <= x && x < slabRight)
+			{
+				keptMoving[threadIndex].push_back(static_cast<uint32_t>(i));
+			}
+		}
+	});
+
+	// Everything left of the halo sorts before it, so that's where the kept circles start in the full sorted order
+	firstStationary = 0u;
+	std::vector<uint32_t> stationarySpawnIndex;
+	std::vector<uint32_t> movingSpawnIndex;
+	for (auto i = 0u; i < numThreads; ++i)
+	{
+		firstStationary += stationaryBefore[i];
+		stationarySpawnIndex.insert(stationarySpawnIndex.end(), keptStationary[i].begin(), keptStationary[i].end());
+		movingSpawnIndex.insert(movingSpawnIndex.end(), keptMoving[i].begin(), keptMoving[i].end());
+	}
+
+	// Kept circles are in spawn order, so ties still break by spawn index like the full sort
+	std::vector<float> keptX(stationarySpawnIndex.size());
+	for (size_t i = 0; i < keptX.size(); ++i)
+	{
+		keptX[i] = uniform(stationaryX, stationarySpawnIndex[i], config.xSpawnRange);
+	}
+	const auto sortedOrder = parallel_sort_order(pool, keptX);
+
+	const auto numKeptStationary = stationarySpawnIndex.size();
+	const auto numKeptMoving = movingSpawnIndex.size();
+	sColData.allocate(arena, numKeptStationary, interleave_alignment(config));
+	sUniqueArray.allocate(arena, numKeptStationary);
+	mColData.allocate(arena, numMoving);
+	mUniqueArray.allocate(arena, numMoving);
+	mColData.count = numKeptMoving;
+	mUniqueArray.count = numKeptMoving;
+
+	if (config.interleaveStationary)
+	{
+		interleave_stationary(config, pool, sColData);
+	}
+
+	pool.run([&](uint32_t threadIndex)
+	{
+		size_t begin, end;
+		thread_range(pool, threadIndex, numKeptStationary, begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto from = stationarySpawnIndex[sortedOrder[i].index];
+			sColData.x[i] = sortedOrder[i].x;
+			sColData.y[i] = uniform(stationaryY, from, config.ySpawnRange);
+			sColData.radius[i] = random_radius(stationaryRadius, from, config);
+
+			// Colors are by sorted index in the full scene
+			sUniqueArray.color[i] = random_color(stationaryColor, firstStationary + i);
+			sColData.uniqueIndex[i] = static_cast<uint32_t>(i);
+		}
+
+		thread_range(pool, threadIndex, numKeptMoving, begin, end);
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto from = movingSpawnIndex[i];
+			mColData.x[i] = uniform(movingX, from, config.xSpawnRange);
+			mColData.y[i] = uniform(movingY, from, config.ySpawnRange);
+			mColData.velocityX[i] = uniform(movingVelocityX, from, config.xVelocityRange);
+			mColData.velocityY[i] = uniform(movingVelocityY, from, config.yVelocityRange);
+			mColData.radius[i] = random_radius(movingRadius, from, config);
+			mColData.hp[i] = 100;
+			mColData.id[i] = static_cast<uint32_t>(from);
+			mUniqueArray.color[i] = random_color(movingColor, from);
+		}
+	});
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "defines.hpp"
+#include "simulation_config.hpp"
+#include "libraries/aligned_arena.hpp"
+#include "libraries/thread_pool.hpp"
+
+// Allocates and fills the starting circles for a config from its seed
+// The simulator and the kernel benchmarks both build their scene with this so they see exactly the same circles
+// Stationary circles come out sorted by x, ready for the line sweep
+// Every thread in the pool takes a share. The scene is bit for bit the same whatever the thread count
+void generate_scene(const simulation_config& config, thread_pool& pool, aligned_arena& arena,
+	stationary_collision_array& sColData, stationary_unique_array& sUniqueArray,
+	moving_collision_array& mColData, moving_unique_array& mUniqueArray);
+
+// Deals the pages of fresh arena memory out between the threads of the pool, for the interleave_stationary option
+// Huge pages are dealt out whole. Has to be done before anything is written to the memory
+// The memory should be allocated aligned to interleave_alignment, or the pages at each end are shared with other arrays
+void interleave_pages(const simulation_config& config, thread_pool& pool, void* memory, size_t bytes);
+
+// Size of the pages interleave_pages deals out when interleave_stationary is on, otherwise 0 for the arenas own alignment
+size_t interleave_alignment(const simulation_config& config);
+
+// Only the part of the same scene one rank of _MULTI_PROCESS_ needs. Moving circles with slabLeft <= x < slabRight,
+// and the stationary circles they could touch by the end of the next frame. firstStationary is set to the sorted index of the first one
+// Stationary circles are in the same order with the same colors as generate_scene. Moving arrays have room for every
+// moving circle in the scene, as that's how many could end up in one slab
+void generate_slab_scene(const simulation_config& config, thread_pool& pool, aligned_arena& arena, float slabLeft, float slabRight,
+	stationary_collision_array& sColData, stationary_unique_array& sUniqueArray, size_t& firstStationary,
+	moving_collision_array& mColData, moving_unique_array& mUniqueArray);
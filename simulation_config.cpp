@@ -0,0 +1,349 @@
+#include "simulation_config.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	// Indexes are 32 bit and the chunk cursor runs past the end, so keep well clear of the top
+	constexpr uint32_t MAX_CIRCLES_PER_TYPE = 0x7FFFFFFFu;
+	// Every thread's last take from the cursor is a whole chunk past the end, so that has to stay clear of the top too
+	constexpr uint32_t MAX_CHUNK_SIZE = 1u << 20u;
+
+	std::string trim(const std::string& text)
+	{
+		const auto first = text.find_first_not_of(" \t\r\n");
+		if (first == std::string::npos)
+		{
+			return "";
+		}
+		const auto last = text.find_last_not_of(" \t\r\n");
+		return text.substr(first, last - first + 1);
+	}
+
+	uint32_t parse_uint(const std::string& key, const std::string& value)
+	{
+		// stoull accepts a leading minus so check for digits only
+		if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+		{
+			throw std::runtime_error("Option " + key + " needs a whole number, got '" + value + "'");
+		}
+
+		const auto parsed = std::stoull(value);
+		if (parsed > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error("Option " + key + " is too big: " + value);
+		}
+		return static_cast<uint32_t>(parsed);
+	}
+
+	float parse_float(const std::string& key, const std::string& value)
+	{
+		std::istringstream stream(value);
+		float parsed;
+		std::string leftOver;
+		if (!(stream >> parsed) || (stream >> leftOver))
+		{
+			throw std::runtime_error("Option " + key + " needs a number, got '" + value + "'");
+		}
+		return parsed;
+	}
+
+	bool parse_bool(const std::string& key, const std::string& value)
+	{
+		if (value == "1" || value == "true" || value == "on")
+		{
+			return true;
+		}
+		if (value == "0" || value == "false" || value == "off")
+		{
+			return false;
+		}
+		throw std::runtime_error("Option " + key + " needs on or off, got '" + value + "'");
+	}
+
+	aligned_arena::page_mode parse_page_mode(const std::string& key, const std::string& value)
+	{
+		if (value == "normal")
+		{
+			return aligned_arena::page_mode::normal;
+		}
+		if (value == "transparent")
+		{
+			return aligned_arena::page_mode::transparent_huge;
+		}
+		if (value == "explicit")
+		{
+			return aligned_arena::page_mode::explicit_huge;
+		}
+		throw std::runtime_error("Option " + key + " needs normal, transparent or explicit, got '" + value + "'");
+	}
+
+	Vector2f parse_range(const std::string& key, const std::string& value)
+	{
+		// Either "min,max" or "min max"
+		std::string spaced = value;
+		std::replace(spaced.begin(), spaced.end(), ',', ' ');
+
+		std::istringstream stream(spaced);
+		float min, max;
+		std::string leftOver;
+		if (!(stream >> min >> max) || (stream >> leftOver))
+		{
+			throw std::runtime_error("Option " + key + " needs a range as min,max, got '" + value + "'");
+		}
+		return Vector2f(min, max);
+	}
+}
+
+float simulation_config::max_collision_distance() const
+{
+#ifdef _RANDOM_RADIUS_
+	return 2.0f * radiusRange.y();
+#else
+	return 2.0f;
+#endif
+}
+
+void simulation_config::set(const std::string& key, const std::string& value)
+{
+	if (key == "circles")
+	{
+		// Split between the two types like the original fixed count was
+		const auto circles = parse_uint(key, value);
+		numStationaryCircles = circles / 2;
+		numMovingCircles = circles - circles / 2;
+	}
+	else if (key == "stationary")
+	{
+		numStationaryCircles = parse_uint(key, value);
+	}
+	else if (key == "moving")
+	{
+		numMovingCircles = parse_uint(key, value);
+	}
+	else if (key == "seed")
+	{
+		seed = parse_uint(key, value);
+	}
+	else if (key == "threads")
+	{
+		threads = parse_uint(key, value);
+	}
+	else if (key == "chunk_size")
+	{
+		chunkSize = parse_uint(key, value);
+	}
+	else if (key == "spawn_x")
+	{
+		xSpawnRange = parse_range(key, value);
+	}
+	else if (key == "spawn_y")
+	{
+		ySpawnRange = parse_range(key, value);
+	}
+	else if (key == "velocity_x")
+	{
+		xVelocityRange = parse_range(key, value);
+	}
+	else if (key == "velocity_y")
+	{
+		yVelocityRange = parse_range(key, value);
+	}
+	else if (key == "radius")
+	{
+		radiusRange = parse_range(key, value);
+	}
+	else if (key == "time_step")
+	{
+		timeStep = parse_float(key, value);
+	}
+	else if (key == "log_file")
+	{
+		logFile = value;
+	}
+	else if (key == "stats_file")
+	{
+		statsFile = value;
+	}
+	else if (key == "events_file")
+	{
+		eventsFile = value;
+	}
+	else if (key == "checkpoint_every")
+	{
+		checkpointEvery = parse_uint(key, value);
+	}
+	else if (key == "checkpoint_file")
+	{
+		checkpointFile = value;
+	}
+	else if (key == "resume")
+	{
+		resumeFile = value;
+	}
+	else if (key == "raster_every")
+	{
+		rasterEvery = parse_uint(key, value);
+	}
+	else if (key == "raster_file")
+	{
+		rasterFile = value;
+	}
+	else if (key == "raster_width")
+	{
+		rasterWidth = parse_uint(key, value);
+	}
+	else if (key == "raster_height")
+	{
+		rasterHeight = parse_uint(key, value);
+	}
+	else if (key == "raster_threads")
+	{
+		rasterThreads = parse_uint(key, value);
+	}
+	else if (key == "ranks")
+	{
+		ranks = parse_uint(key, value);
+	}
+	else if (key == "pin_threads")
+	{
+		pinThreads = parse_bool(key, value);
+	}
+	else if (key == "first_touch")
+	{
+		firstTouch = parse_bool(key, value);
+	}
+	else if (key == "interleave_stationary")
+	{
+		interleaveStationary = parse_bool(key, value);
+	}
+	else if (key == "huge_pages")
+	{
+		hugePages = parse_page_mode(key, value);
+	}
+	else
+	{
+		throw std::runtime_error("Unknown option " + key + ". Options are circles, stationary, moving, seed, threads, chunk_size, spawn_x, spawn_y, velocity_x, velocity_y, radius, time_step, log_file, stats_file, events_file, checkpoint_every, checkpoint_file, resume, raster_every, raster_file, raster_width, raster_height, raster_threads, ranks, pin_threads, first_touch, interleave_stationary, huge_pages and config");
+	}
+}
+
+void simulation_config::load_file(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		throw std::runtime_error("Could not open config file " + path);
+	}
+
+	std::string line;
+	uint32_t lineNumber = 0u;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		// Strip comments
+		const auto comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+		line = trim(line);
+		if (line.empty())
+		{
+			continue;
+		}
+
+		const auto equals = line.find('=');
+		if (equals == std::string::npos)
+		{
+			throw std::runtime_error(path + ":" + std::to_string(lineNumber) + " is not key = value");
+		}
+		set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)));
+	}
+}
+
+void simulation_config::validate() const
+{
+	if (numStationaryCircles == 0u || numMovingCircles == 0u)
+	{
+		throw std::runtime_error("Need at least one stationary and one moving circle");
+	}
+	if (numStationaryCircles > MAX_CIRCLES_PER_TYPE || numMovingCircles > MAX_CIRCLES_PER_TYPE)
+	{
+		throw std::runtime_error("At most " + std::to_string(MAX_CIRCLES_PER_TYPE) + " circles of each type");
+	}
+
+	if (chunkSize == 0u || chunkSize > MAX_CHUNK_SIZE)
+	{
+		throw std::runtime_error("Chunk size needs to be between 1 and " + std::to_string(MAX_CHUNK_SIZE));
+	}
+
+	// Spawn ranges must have some area as the grid divides them into cells
+	if (!(xSpawnRange.x() < xSpawnRange.y()) || !(ySpawnRange.x() < ySpawnRange.y()))
+	{
+		throw std::runtime_error("Spawn ranges need min < max");
+	}
+	if (!(xVelocityRange.x() <= xVelocityRange.y()) || !(yVelocityRange.x() <= yVelocityRange.y()))
+	{
+		throw std::runtime_error("Velocity ranges need min <= max");
+	}
+	if (!(radiusRange.x() > 0.0f) || !(radiusRange.x() <= radiusRange.y()))
+	{
+		throw std::runtime_error("Radius range needs 0 < min <= max");
+	}
+	if (!(timeStep > 0.0f))
+	{
+		throw std::runtime_error("Time step needs to be more than 0");
+	}
+	if (rasterEvery == 0u || rasterWidth == 0u || rasterHeight == 0u || rasterThreads == 0u)
+	{
+		throw std::runtime_error("Rasterising needs raster_every, raster_width, raster_height and raster_threads of at least 1");
+	}
+	if (ranks == 0u)
+	{
+		throw std::runtime_error("Need at least one rank");
+	}
+#ifdef _WIN32
+	// The resumed snapshot stays mapped for the whole run, and Windows won't replace a mapped file
+	if (checkpointEvery != 0u && !resumeFile.empty() && resumeFile == checkpointFile)
+	{
+		throw std::runtime_error("Can't checkpoint over the snapshot being resumed from. Give checkpoint_file another name");
+	}
+#endif
+}
+
+simulation_config simulation_config::from_command_line(int argc, char* argv[])
+{
+	simulation_config config;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (argument.size() < 3u || argument.compare(0, 2, "--") != 0)
+		{
+			throw std::runtime_error("Expected an option like --circles, got '" + argument + "'");
+		}
+		if (i + 1 == argc)
+		{
+			throw std::runtime_error("Option " + argument + " is missing its value");
+		}
+
+		const auto key = argument.substr(2);
+		const std::string value = argv[++i];
+		if (key == "config")
+		{
+			config.load_file(value);
+		}
+		else
+		{
+			config.set(key, value);
+		}
+	}
+
+	config.validate();
+	return config;
+}
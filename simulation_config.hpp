@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+
+#include "defines.hpp"
+
+// Everything about the scene that can change without recompiling
+// Starts with the defaults from defines.hpp, then a config file and/or the command line override them
+//
+// Command line:	--circles 4000000 --threads 64 --spawn_x -2000,2000 --config run.cfg --resume simulation.snapshot
+// Config file:		one "key = value" per line, # starts a comment. Ranges are "min, max" or "min max"
+struct simulation_config
+{
+	uint32_t	numStationaryCircles = DEFAULT_NUM_OF_CIRCLES / 2;
+	uint32_t	numMovingCircles = DEFAULT_NUM_OF_CIRCLES / 2;
+	uint32_t	seed = DEFAULT_SPAWN_SEED;
+
+	// Including the main thread. 0 uses every hardware thread
+	uint32_t	threads = 0u;
+	// Moving circles handed to a thread at a time in the collide phase
+	uint32_t	chunkSize = DEFAULT_COLLISION_CHUNK_SIZE;
+
+	Vector2f	xSpawnRange = DEFAULT_X_SPAWN_RANGE;
+	Vector2f	ySpawnRange = DEFAULT_Y_SPAWN_RANGE;
+
+	Vector2f	xVelocityRange = DEFAULT_X_VELOCITY_RANGE;
+	Vector2f	yVelocityRange = DEFAULT_Y_VELOCITY_RANGE;
+
+	// Only used with _RANDOM_RADIUS_, otherwise every circle has a radius of 1
+	Vector2f	radiusRange = DEFAULT_CIRCLE_RADIUS_RANGE;
+
+	// Circles move velocity * timeStep each frame. Much above 1 circles tunnel through each other unless _SWEPT_COLLISIONS_ is on
+	float		timeStep = 1.0f;
+
+	// Where _OUTPUT_ALL_ writes. Empty for stdout
+	std::string	logFile;
+
+	// Where _EXPORT_THREAD_STATS_ writes. .json for a Chrome trace, anything else for CSV
+	std::string	statsFile = "thread_stats.csv";
+
+	// Where _RECORD_COLLISION_EVENTS_ writes
+	std::string	eventsFile = "collisions.events";
+
+	// Writes a snapshot to checkpointFile every this many frames. 0 never does
+	uint32_t	checkpointEvery = 0u;
+	std::string	checkpointFile = "simulation.snapshot";
+
+	// Snapshot to carry on from instead of generating a scene. Its scene replaces the one set here
+	// Stays mapped while the run lasts. POSIX can checkpoint over it, Windows can't so needs another checkpointFile
+	std::string	resumeFile;
+
+	// _RASTERISE_FRAMES_ writes a rasterFile_<frame>.ppm heatmap of the spawn range every this many frames
+	uint32_t	rasterEvery = 10u;
+	std::string	rasterFile = "density";
+	uint32_t	rasterWidth = 1024u;
+	uint32_t	rasterHeight = 1024u;
+	// With _PUBLISH_FRAME_STATE_ too the heatmap is drawn on the consumer thread and this many threads in all, consumer included
+	// Kept small as they share the CPUs with the simulation
+	uint32_t	rasterThreads = 2u;
+
+	// Processes the spawn area is split between. Only used with _MULTI_PROCESS_
+	uint32_t	ranks = 2u;
+
+	// Memory placement for machines with more than one NUMA node. Scenes resumed from a snapshot stay where the file is mapped
+	// Pins each thread to its own CPU, in order, so threads stay next to the pages they first wrote
+	bool		pinThreads = false;
+	// Each thread collides the slice of moving circles it generated first, and only helps with the others once that's done
+	bool		firstTouch = false;
+	// Stationary circles and their HP are looked up by every thread, so their pages are dealt out between the threads instead
+	// Each of those arrays is padded to whole pages of its own, up to a huge page each with huge_pages
+	bool		interleaveStationary = false;
+	// Backs the circle arrays with huge pages, so the searches over them miss the TLB far less
+	aligned_arena::page_mode	hugePages = aligned_arena::page_mode::normal;
+
+	uint32_t num_circles() const { return numStationaryCircles + numMovingCircles; }
+
+	// Furthest two circles can be apart and still touch
+	float max_collision_distance() const;
+
+	// Sets one option by name. Throws std::runtime_error if the key or value is bad
+	void set(const std::string& key, const std::string& value);
+
+	// Reads "key = value" lines from a file
+	void load_file(const std::string& path);
+
+	// Throws std::runtime_error if the options don't make a usable scene
+	void validate() const;
+
+	// Defaults, then anything given with --key value. --config file is applied where it appears
+	static simulation_config from_command_line(int argc, char* argv[]);
+};
@@ -1,106 +1,164 @@
 #include "simulator.hpp"
 
+#include "collision_kernels.hpp"
+#include "libraries/numa_placement.hpp"
 #include "libraries/threadstream.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 
-simulator::simulator(uint32_t seed)
+#ifdef _MULTI_PROCESS_
+simulator::simulator(const simulation_config& config, slab_ranks& ranks) : m_Config(config), m_Ranks(&ranks)
+#else
+simulator::simulator(const simulation_config& config) : m_Config(config)
+#endif
 {
-	#pragma region SIMULATION SETUP
-	// Init a number generator
-	std::default_random_engine rng(seed);
-
-	// Create distributions from data in constants.hpp
-	const auto positionXDist = rand_float_dist(X_SPAWN_RANGE.x(), X_SPAWN_RANGE.y());
-	const auto positionYDist = rand_float_dist(Y_SPAWN_RANGE.x(), Y_SPAWN_RANGE.y());
-	const auto velocityXDist = rand_float_dist(X_VELOCITY_RANGE.x(), X_VELOCITY_RANGE.y());
-	const auto velocityYDist = rand_float_dist(Y_VELOCITY_RANGE.x(), Y_VELOCITY_RANGE.y());
+	m_Config.validate();
 
-	// RGB is 0-1
-	const auto colorDist = rand_float_dist(0.0f, 1.0f);
-
-	// Setup stationary circles
-	for (auto i = 0u; i < NUM_STATIONARY_CIRCLES; ++i)
+	#pragma region THREADING SETUP
+	// Use the configured thread count, otherwise work out hardware threads if possible
+	m_NumWorkers = m_Config.threads != 0u ? m_Config.threads : std::thread::hardware_concurrency();
+	// Sometimes it doesn't work so assume 8
+	if (m_NumWorkers == 0) m_NumWorkers = 8;
+	// Main thread already running
+	--m_NumWorkers;
+	// Setup threads
+	m_CollisionWork.resize(static_cast<size_t>(m_NumWorkers) + 1u);
+	for (uint32_t i = 0; i <= m_NumWorkers; ++i)
 	{
-		// Get array refs
-
-		auto& sColData = m_StationaryCollisionData.at(i);
-		// Collision setup
-		sColData.position = Vector2f(positionXDist(rng), positionYDist(rng));
-#ifdef _RANDOM_RADIUS_
-		sColData.radius = rand_float_dist(CIRCLE_RADIUS_RANGE.x(), CIRCLE_RADIUS_RANGE.y())(rng);
-#else
-		sColData.radius = 1.0f;
-#endif
+		m_CollisionWork.at(i).threadIndex = i;
 	}
+	// Made first so the scene can be generated in parallel
+	m_ThreadPool = std::make_unique<thread_pool>(m_NumWorkers);
 
-	// Sort stationary circles to allow line sweep
-	std::sort(m_StationaryCollisionData.begin(), m_StationaryCollisionData.end(), [](auto& a, auto& b)
+	// Before anything is allocated, so every page is first touched from the CPU that will use it
+	if (m_Config.pinThreads)
 	{
-		return a.position.x() < b.position.x();
-	});
+		pin_threads();
+	}
 
-	// Now setup unique data for sorted collision circles
-	for (auto i = 0u; i < NUM_STATIONARY_CIRCLES; ++i)
+	// Each thread starts the collide phase on its own slice of the moving circles
+	if (m_Config.firstTouch)
 	{
-		auto& sUniqueData = m_StationaryUniqueData.at(i);
-		sUniqueData.color = Vector3f(colorDist(rng), colorDist(rng), colorDist(rng));
-		sUniqueData.hp = 100;
-		sUniqueData.name = "S" + std::to_string(i);
-
-		// Store reference to unique array if using better algorithm
-		auto& uniqueIndex = m_StationaryCollisionData.at(i).uniqueIndex;
-		uniqueIndex = i;
-		
+		m_ChunkSlices = std::vector<chunk_slice>(m_NumWorkers + 1u);
 	}
 
-	// Setup moving circles
-	for (auto i = 0u; i < NUM_MOVING_CIRCLES; ++i)
-	{
-		// Get array refs
-		auto& mColData = m_MovingCollisionData.at(i);
-		auto& mUniqueData = m_MovingUniqueData.at(i);
+	#pragma endregion
 
-		// Collision setup
-		mColData.position = Vector2f(positionXDist(rng), positionYDist(rng));
-		mColData.velocity = Vector2f(velocityXDist(rng), velocityYDist(rng));
-#ifdef _RANDOM_RADIUS_
-		mColData.radius = rand_float_dist(CIRCLE_RADIUS_RANGE.x(), CIRCLE_RADIUS_RANGE.y())(rng);
-#else
-		mColData.radius = 1.0f;
-#endif
-		
-		// Unique setup
-		mUniqueData.color = Vector3f(colorDist(rng), colorDist(rng), colorDist(rng));
-		mUniqueData.hp = 100;
-		mUniqueData.name = "M" + std::to_string(i);
+	#pragma region SIMULATION SETUP
+	if (!m_Config.resumeFile.empty())
+	{
+		// Carry on exactly where the snapshot left off
+		m_Snapshot = load_snapshot(m_Config.resumeFile, m_Config, m_Frame, m_StationaryCollisionData, m_StationaryUniqueData, m_StationaryHP,
+			m_MovingCollisionData, m_MovingUniqueData);
+	}
+	else
+	{
+		#ifdef _MULTI_PROCESS_
+		// Only this ranks slab. Stationary HP is shared by every rank and indexed from where this ranks circles start
+		const auto rank = m_Ranks->rank();
+		generate_slab_scene(m_Config, *m_ThreadPool, m_Arena, m_Ranks->slab_left(rank), m_Ranks->slab_right(rank),
+			m_StationaryCollisionData, m_StationaryUniqueData, m_FirstStationary, m_MovingCollisionData, m_MovingUniqueData);
+		m_StationaryHP = m_Ranks->stationary_hp() + m_FirstStationary;
+		#else
+		generate_scene(m_Config, *m_ThreadPool, m_Arena, m_StationaryCollisionData, m_StationaryUniqueData, m_MovingCollisionData, m_MovingUniqueData);
+
+		// Arena memory is raw so the atomics need constructing
+		m_StationaryHP = m_Arena.allocate<std::atomic<int32_t>>(m_Config.numStationaryCircles, interleave_alignment(m_Config));
+		if (m_Config.interleaveStationary)
+		{
+			interleave_pages(m_Config, *m_ThreadPool, m_StationaryHP, m_Config.numStationaryCircles * sizeof(std::atomic<int32_t>));
+		}
+		for (auto i = 0u; i < m_Config.numStationaryCircles; ++i)
+		{
+			new (&m_StationaryHP[i]) std::atomic<int32_t>(100);
+		}
+		#endif
 	}
+
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	// A snapshot from a run without this option can still have destroyed circles in it
+	remove_already_destroyed();
+	#endif
+
+	#ifdef _QUANTIZED_POSITIONS_
+	// Never stored in snapshots as it only takes a moment to rebuild
+	quantize_stationary_positions();
+	#endif
+
+	#ifdef _EYTZINGER_SEARCH_
+	build_stationary_search();
+	#endif
+
+	#ifdef _USE_SPATIAL_GRID_
+	// Stationary circles never move so the grid only needs building once
+	build_stationary_grid();
+	#endif
+
+	#ifdef _MOVING_COLLISIONS_
+	m_MovingSortKeys = m_Arena.allocate<moving_sort_key>(m_Config.numMovingCircles);
+	m_MovingSortScratch = m_Arena.allocate<moving_sort_key>(m_Config.numMovingCircles);
+	m_MovingSorted = m_Arena.allocate<moving_sorted_circle>(m_Config.numMovingCircles);
+	m_RadixCounts = m_Arena.allocate<uint32_t>(static_cast<size_t>(m_NumWorkers + 1) * RADIX_BUCKETS);
+	#endif
+
 	#pragma endregion
 
-	#pragma region THREADING SETUP
-	// Work out hardware threads if possible
-	m_NumWorkers = std::thread::hardware_concurrency();
-	// Sometimes it doesn't work so assume 8
-	if (m_NumWorkers == 0) m_NumWorkers = 8;
-	// Main thread already running
-	--m_NumWorkers;
-	// Setup threads
-	for (uint32_t i = 0; i < m_NumWorkers; ++i)
+	#pragma region OUTPUT SETUP
+	#ifdef _OUTPUT_ALL_
+	m_CollisionLog = std::make_unique<collision_log>(m_NumWorkers + 1, COLLISION_LOG_QUEUE_SIZE, m_Config.logFile);
+	#endif
+
+	#ifdef _RECORD_COLLISION_EVENTS_
+	m_CollisionEvents = std::make_unique<collision_event_writer>(m_NumWorkers + 1, m_Config.eventsFile,
+		m_Config.numStationaryCircles, m_Config.numMovingCircles, m_Config.seed);
+	#endif
+
+	#if defined(_RASTERISE_FRAMES_) && defined(_PUBLISH_FRAME_STATE_)
+	// The consumer thread draws its share as the last index, like the main thread does in the simulation pool
+	m_RasterPool = std::make_unique<thread_pool>(m_Config.rasterThreads - 1u);
+	m_DensityRaster = std::make_unique<density_raster>(m_Config.rasterWidth, m_Config.rasterHeight, m_Config.xSpawnRange, m_Config.ySpawnRange,
+		m_RasterPool->num_threads());
+	m_NextRasterFrame = (m_Frame / m_Config.rasterEvery + 1u) * m_Config.rasterEvery;
+	#elif defined(_RASTERISE_FRAMES_)
+	m_DensityRaster = std::make_unique<density_raster>(m_Config.rasterWidth, m_Config.rasterHeight, m_Config.xSpawnRange, m_Config.ySpawnRange,
+		m_ThreadPool->num_threads());
+	#endif
+
+	#ifdef _PUBLISH_FRAME_STATE_
+	m_FramePublisher = std::make_unique<frame_publisher>(m_Config.numStationaryCircles, m_Config.numMovingCircles);
+	#ifdef _RASTERISE_FRAMES_
+	m_FramePublisher->add_consumer([this](const frame_state& state)
 	{
-		auto& pairedWorker = m_CollisionWorkers.at(i);
-		pairedWorker.worker.thread = std::thread(&simulator::check_collision, this, i);
-	}
-	
+		rasterise_state(state);
+	});
+	#endif
+	m_FramePublisher->start();
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	m_ThreadStats = std::make_unique<thread_stats_writer>(m_Config.statsFile);
+	m_ThreadStatsStart = thread_pool::clock::now();
+	#endif
+
 	#pragma endregion
 
 	#ifdef _TIME_LOOPS_
 	#pragma region INSTRUMENTATION SETUP
 
-	m_Timer = msc::platform::Timer(false);
+	m_Timer = steady_timer(false);
 	
 	#pragma endregion
 	#endif
 
+	#ifdef _PROFILE_ZONES_
+	// Measures the zone clock now rather than in the first frame
+	profiler::ticks_per_second();
+	#endif
+
 	#ifdef _USE_TL_ENGINE_
 	
 	// Create engine instance
@@ -118,56 +176,68 @@ simulator::simulator(uint32_t seed)
 	m_MovingMesh = m_TLEngine->LoadMesh("Moving.x");
 	
 	// Create models
-	int index = 0;
-	for (auto& stationary : m_StationaryCollisionData)
+	// Sized by the arrays as a resumed run may have had circles removed
+	m_StationaryCircleModels.resize(m_StationaryCollisionData.size());
+	m_MovingCirclesModels.resize(m_MovingCollisionData.size());
+	for (auto index = 0u; index < m_StationaryCollisionData.size(); ++index)
 	{
-		m_StationaryCircleModels.at(index) = m_StationaryMesh->CreateModel(stationary.position.x(), stationary.position.y(), 0.0f);
+		m_StationaryCircleModels.at(index) = m_StationaryMesh->CreateModel(m_StationaryCollisionData.x[index], m_StationaryCollisionData.y[index], 0.0f);
 		m_StationaryCircleModels.at(index)->Scale(0.5f);
-		++index;
 	}
-	index = 0;
-	for (auto& moving : m_MovingCollisionData)
+	for (auto index = 0u; index < m_MovingCollisionData.size(); ++index)
 	{
-		m_MovingCirclesModels.at(index) = m_MovingMesh->CreateModel(moving.position.x(), moving.position.y(), 0.0f);
+		m_MovingCirclesModels.at(index) = m_MovingMesh->CreateModel(m_MovingCollisionData.x[index], m_MovingCollisionData.y[index], 0.0f);
 		m_MovingCirclesModels.at(index)->Scale(0.5f);
-		++index;
 	}
 
 	// Need to scale accordingly. We can simply scale by radius multiplicatively
 	#ifdef _RANDOM_RADIUS_
 
-	index = 0;
+	int index = 0;
 	for (auto& stationary : m_StationaryCircleModels)
 	{
-		stationary->Scale(0.5f * m_StationaryCollisionData.at(index).radius);
+		stationary->Scale(0.5f * m_StationaryCollisionData.radius[index]);
 		++index;
 	}
 	index = 0;
 	for (auto& moving : m_MovingCirclesModels)
 	{
-		moving->Scale(0.5f * m_MovingCollisionData.at(index).radius);
+		moving->Scale(0.5f * m_MovingCollisionData.radius[index]);
 		++index;
 	}
 	
 	#endif
 	
 	// Create camera
-	m_TLCamera = m_TLEngine->CreateCamera(tle::ECameraType::kManual, CAMERA_DEFAULT_POSITION.x(), CAMERA_DEFAULT_POSITION.y(), CAMERA_DEFAULT_POSITION.z());
+	const float cameraStartZ = -((m_Config.xSpawnRange.y() - m_Config.xSpawnRange.x() + (m_Config.ySpawnRange.y() - m_Config.ySpawnRange.x())) / 2.0f);
+	m_CameraDefaultPosition = Vector3f(0.0f, 0.0f, cameraStartZ + CAMERA_BACK_OFFSET);
+	m_TLCamera = m_TLEngine->CreateCamera(tle::ECameraType::kManual, m_CameraDefaultPosition.x(), m_CameraDefaultPosition.y(), m_CameraDefaultPosition.z());
 
 	m_TLCamera->SetFarClip(1000000.0f);
 	
 	#endif
 
-	output_beginning_message();
+	if (is_reporting())
+	{
+		output_beginning_message();
+	}
 }
 
 simulator::~simulator()
 {
-	for (auto i = 0u; i < m_NumWorkers; ++i)
-	{
-		auto& pairedWorker = m_CollisionWorkers.at(i);
-		pairedWorker.worker.thread.detach();
-	}
+	#ifdef _PUBLISH_FRAME_STATE_
+	// Consumers may be reading anything below
+	m_FramePublisher.reset();
+	#endif
+	// Stops and joins the workers
+	m_ThreadPool.reset();
+	#ifdef _OUTPUT_ALL_
+	// Then writes whatever they logged
+	m_CollisionLog.reset();
+	#endif
+	#ifdef _RECORD_COLLISION_EVENTS_
+	m_CollisionEvents.reset();
+	#endif
 	#ifdef _USE_TL_ENGINE_
 
 	m_TLEngine->Stop();
@@ -178,7 +248,7 @@ simulator::~simulator()
 
 void simulator::run()
 {
-	m_Timer.Start();
+	m_Timer.start();
 
 	// Program loop is handled by different parts depending on if visual is running
 	while (
@@ -199,7 +269,7 @@ void simulator::run()
 		// If paused
 		if (m_IsPaused)
 		{
-			timeToProcess = m_Timer.GetLapTime();
+			timeToProcess = m_Timer.lap_time();
 			update_tl(timeToProcess);
 			// Skip loop
 			continue;
@@ -207,86 +277,161 @@ void simulator::run()
 		
 		#endif
 		
-		// Update positions single threaded
-		for (auto i = 0u; i < NUM_MOVING_CIRCLES; ++i)
-		{
-			auto& mColData = m_MovingCollisionData.at(i);
-			mColData.position += mColData.velocity;
-		}
+		// Pool times are per frame
+		m_ThreadPool->reset_times();
 
-		// Check collisions threaded
+		#ifdef _PROFILE_ZONES_
+		// Everything timed until the lap goes under this
+		profiler::scoped_zone frameZone("frame");
+		#endif
 
-		// These pointers will move
-		auto* movingColPointer = m_MovingCollisionData.data();
-		auto* movingUniquePointer = m_MovingUniqueData.data();
-		
-		for (auto i = 0u; i < m_NumWorkers; ++i)
+		#if defined(_TIME_LOOPS_) && !defined(_MULTI_PROCESS_)
+		// Circles can be removed at the end of the frame so note how many this one started with
+		const auto circlesThisFrame = m_StationaryCollisionData.size() + m_MovingCollisionData.size();
+		#endif
+
+		// Move and check collisions threaded
+		// Positions are updated a chunk at a time right before that chunk is collided, while it is still in cache
+
+		// Every thread, main included, shares the same arrays
+		// Sections of moving circles are handed out a chunk at a time while the phase runs
+		for (auto i = 0u; i <= m_NumWorkers; ++i)
 		{
-			auto& pairedWorker = m_CollisionWorkers.at(i);
+			auto& work = work_for_thread(i);
+
+			work.sCirclesCol = &m_StationaryCollisionData;
+			work.sCirclesHP = m_StationaryHP;
 
-			pairedWorker.work.sCirclesCol = m_StationaryCollisionData.data();
-			pairedWorker.work.sCirclesUnique = m_StationaryUniqueData.data();
-			pairedWorker.work.sCirclesMutexes = m_StationaryMutexes.data();
+			#ifdef _USE_SPATIAL_GRID_
+			work.sGridCellStarts = m_StationaryGridCellStarts;
+			work.sGridIndices = m_StationaryGridIndices;
+			#endif
 
-			pairedWorker.work.mCirclesCol = movingColPointer;
-			pairedWorker.work.mCircleUnique = movingUniquePointer;
-			pairedWorker.work.mNumberOfCircles = static_cast<uint32_t>(m_MovingCollisionData.size() / m_NumWorkers);
+			work.mCirclesCol = &m_MovingCollisionData;
 
 			// Reset number of collisions
 			#ifdef _TRACK_COLLISIONS_
 
-			pairedWorker.work.numberOfCollisions = 0u;
+			work.numberOfCollisions = 0u;
 
 			#endif
 
-			// Flag the work as incomplete
-			{
-				std::unique_lock<std::mutex> l(pairedWorker.worker.lock);
-				pairedWorker.work.complete = false;
-			}
+			#ifdef _TIME_THREADS_
 
-			// Notify
-			pairedWorker.worker.workReady.notify_one();
+			work.busyTime = 0.0f;
 
-			// Move on
-			movingColPointer += pairedWorker.work.mNumberOfCircles;
-			movingUniquePointer += pairedWorker.work.mNumberOfCircles;
-		}
+			#endif
 
-		// Process remaning on main thread
-		const uint32_t remainingCircles = static_cast<uint32_t>(m_MovingCollisionData.size()) - static_cast<uint32_t>(movingColPointer - m_MovingCollisionData.data());
-		auto mainThreadWork = collision_work();
+			#ifdef _EXPORT_THREAD_STATS_
+			// Reset per phase when recorded. Also here so the deferred moving pairs of the last frame don't count
+			work.candidatesTested = 0u;
+			work.phaseHits = 0u;
+			#endif
+		}
 
-		mainThreadWork.sCirclesCol = m_StationaryCollisionData.data();
-		mainThreadWork.sCirclesUnique = m_StationaryUniqueData.data();
-		mainThreadWork.sCirclesMutexes = m_StationaryMutexes.data();
+		#ifdef _MULTI_PROCESS_
+		const auto frameStart = thread_pool::clock::now();
+		#endif
 
-		mainThreadWork.mCirclesCol = movingColPointer;
-		mainThreadWork.mCircleUnique = movingUniquePointer;
-		mainThreadWork.mNumberOfCircles = remainingCircles;
+		// Process
+		m_NextChunk.store(0u, std::memory_order_relaxed);
+		if (m_Config.firstTouch)
+		{
+			reset_chunk_slices(static_cast<uint32_t>(m_MovingCollisionData.size()));
+		}
+		run_phase(work_phase::collide_stationary);
 
-		// Reset number of collisions
+		#ifdef _MULTI_PROCESS_
+		// Circles have moved, so some now belong to the next slab along
+		rank_frame_stats rankStats;
+		const auto collideEnd = thread_pool::clock::now();
+		{
+			#ifdef _PROFILE_ZONES_
+			profiler::scoped_zone zone("migrate");
+			#endif
+			rankStats.migrated = migrate_moving_circles();
+		}
+		rankStats.movingCircles = static_cast<uint32_t>(m_MovingCollisionData.size());
+		rankStats.collideTime = std::chrono::duration<float>(collideEnd - frameStart).count();
+		rankStats.exchangeTime = std::chrono::duration<float>(thread_pool::clock::now() - collideEnd).count();
 		#ifdef _TRACK_COLLISIONS_
+		for (auto i = 0u; i <= m_NumWorkers; ++i)
+		{
+			rankStats.collisions += work_for_thread(i).numberOfCollisions;
+		}
+		#endif
+		#endif
 
-		mainThreadWork.numberOfCollisions = 0u;
+		#ifdef _MOVING_COLLISIONS_
+
+		// Sort then sweep moving circles against each other
+		{
+			#ifdef _PROFILE_ZONES_
+			profiler::scoped_zone zone("sort_moving");
+			#endif
+			sort_moving_circles();
+		}
+		m_NextChunk.store(0u, std::memory_order_relaxed);
+		run_phase(work_phase::collide_moving);
 
+		#ifdef _PROFILE_ZONES_
+		profiler::scoped_zone deferredZone("deferred_pairs");
 		#endif
 
-		// Process
-		process_collision_sweep(&mainThreadWork);
+		// Pairs that crossed between chunks are done here so no circle is written by two threads
+		// Chunks go to whichever thread is free so sort the pairs to keep this deterministic
+		std::vector<moving_circle_pair> deferredPairs;
+		for (auto i = 0u; i <= m_NumWorkers; ++i)
+		{
+			auto& work = work_for_thread(i);
+			deferredPairs.insert(deferredPairs.end(), work.deferredPairs.begin(), work.deferredPairs.end());
+			work.deferredPairs.clear();
+		}
+		std::sort(deferredPairs.begin(), deferredPairs.end(), [](const moving_circle_pair& l, const moving_circle_pair& r)
+		{
+			return l.a != r.a ? l.a < r.a : l.b < r.b;
+		});
+		for (const auto& pair : deferredPairs)
+		{
+			resolve_moving_collision(&work_for_thread(m_NumWorkers), pair);
+		}
+
+		#ifdef _PROFILE_ZONES_
+		deferredZone.end();
+		#endif
+
+		#endif
 
-		// Wait for workers to finish
-		for (auto i = 0u; i < m_NumWorkers; ++i)
+		#ifdef _REMOVE_DESTROYED_CIRCLES_
+		// Part of the frame, so shows in its time
 		{
-			auto& pairedWorker = m_CollisionWorkers.at(i);
-			{
-				std::unique_lock <std::mutex> l(pairedWorker.worker.lock);
-				pairedWorker.worker.workReady.wait(l, [&]() {return pairedWorker.work.complete; });
-			}
+			#ifdef _PROFILE_ZONES_
+			profiler::scoped_zone zone("remove_destroyed");
+			#endif
+			remove_destroyed_circles();
 		}
+		#endif
+
+		#if defined(_PUBLISH_FRAME_STATE_)
+		// Part of the frame, so shows in its time. Consumers read the copy while the next frame runs
+		#ifdef _PROFILE_ZONES_
+		profiler::scoped_zone publishZone("publish");
+		#endif
+		m_FramePublisher->publish(*m_ThreadPool, m_Frame + 1u, m_StationaryVersion, m_StationaryCollisionData, m_StationaryHP, m_MovingCollisionData);
+		#ifdef _PROFILE_ZONES_
+		publishZone.end();
+		#endif
+		#elif defined(_RASTERISE_FRAMES_)
+		// Part of the frame, so shows in its time
+		rasterise_frame();
+		#endif
 
 		// Get time without macro. This is because we need it for TL Engine
-		timeToProcess = m_Timer.GetLapTime();
+		timeToProcess = m_Timer.lap_time();
+
+		#ifdef _PROFILE_ZONES_
+		frameZone.end();
+		#endif
 
 		#ifdef _USE_TL_ENGINE_
 		
@@ -298,21 +443,57 @@ void simulator::run()
 		// Output macro dependent how long the loop took
 
 		// Want to output time
-		#ifdef _TIME_LOOPS_
+		#if defined(_MULTI_PROCESS_)
+			output_rank_frame(rankStats, timeToProcess);
+		#elif defined(_TIME_LOOPS_)
 			#ifdef _TRACK_COLLISIONS_
 				uint32_t totalCollisions = 0u;
 
-				for (auto& pairedWorker : m_CollisionWorkers)
+				for (auto i = 0u; i <= m_NumWorkers; ++i)
 				{
-					totalCollisions += pairedWorker.work.numberOfCollisions;
+					totalCollisions += work_for_thread(i).numberOfCollisions;
 				}
 		
-				TOUT << "Processed " << NUM_OF_CIRCLES << " circles in " << timeToProcess << " Total Collisions: " << totalCollisions << '\n';
+				TOUT << "Processed " << circlesThisFrame << " circles in " << timeToProcess << " Total Collisions: " << totalCollisions << " Dispatch/Join: " << m_ThreadPool->overhead_time() << '\n';
 			#else
-				TOUT << "Processed " << NUM_OF_CIRCLES << " circles in " << timeToProcess << '\n';
+				TOUT << "Processed " << circlesThisFrame << " circles in " << timeToProcess << " Dispatch/Join: " << m_ThreadPool->overhead_time() << '\n';
 			#endif
 		#endif
 
+		#ifdef _REMOVE_DESTROYED_CIRCLES_
+		TOUT << "\tLive Circles: " << m_StationaryCollisionData.size() << " stationary, " << m_MovingCollisionData.size() << " moving\n";
+		#endif
+
+		#ifdef _TIME_THREADS_
+		if (is_reporting())
+		{
+			output_thread_times();
+		}
+		#endif
+
+		#ifdef _PROFILE_ZONES_
+		// Every rank starts each frame from zero, but only the first prints
+		std::ostringstream zoneTimes;
+		profiler::report(zoneTimes);
+		if (is_reporting())
+		{
+			TOUT << zoneTimes.str();
+		}
+		#endif
+
+		#ifdef _EXPORT_THREAD_STATS_
+		m_ThreadStats->end_frame();
+		#endif
+
+		#ifdef _RECORD_COLLISION_EVENTS_
+		// Workers are parked so their partly filled chunks can be handed over
+		m_CollisionEvents->flush();
+		#endif
+
+		++m_Frame;
+
+		write_checkpoint();
+
 		#ifdef  _PAUSE_AFTER_EACH_FRAME_
 		// Wait for input
 		std::cin.get();
@@ -332,14 +513,32 @@ void simulator::output_beginning_message()
 	TOUT << "Using " << m_NumWorkers + 1 << " threads!\n";
 	// Output shared config by all setups
 	TOUT << "Simulation Configuration:\n";
-	TOUT << "\tCircles: " << NUM_OF_CIRCLES << '\n';
-	TOUT << "\tSeed: " << SPAWN_SEED << '\n';
-	TOUT << "\tSpawn Range X: " << X_SPAWN_RANGE.x() << " --> " << X_SPAWN_RANGE.y() << " Y: " << Y_SPAWN_RANGE.x() << " --> " << Y_SPAWN_RANGE.y() << '\n';
-	TOUT << "\tInitial Velocities X: " << X_VELOCITY_RANGE.x() << " --> " << X_VELOCITY_RANGE.y() << " Y: " << Y_VELOCITY_RANGE.x() << " --> " << Y_VELOCITY_RANGE.y() << '\n';
+	TOUT << "\tCircles: " << m_Config.num_circles() << " (" << m_Config.numStationaryCircles << " stationary, " << m_Config.numMovingCircles << " moving)\n";
+	TOUT << "\tSeed: " << m_Config.seed << '\n';
+	TOUT << "\tCircle Data: " << circle_data_size() / (1024 * 1024) << " MB\n";
+	TOUT << "\tCollision Chunk Size: " << m_Config.chunkSize << '\n';
+	TOUT << "\tSpawn Range X: " << m_Config.xSpawnRange.x() << " --> " << m_Config.xSpawnRange.y() << " Y: " << m_Config.ySpawnRange.x() << " --> " << m_Config.ySpawnRange.y() << '\n';
+	TOUT << "\tInitial Velocities X: " << m_Config.xVelocityRange.x() << " --> " << m_Config.xVelocityRange.y() << " Y: " << m_Config.yVelocityRange.x() << " --> " << m_Config.yVelocityRange.y() << '\n';
+	TOUT << "\tTime Step: " << m_Config.timeStep << '\n';
+	if (m_Snapshot)
+	{
+		TOUT << "\tResumed From: " << m_Config.resumeFile << " at frame " << m_Frame << '\n';
+	}
+	if (m_Config.checkpointEvery != 0u)
+	{
+		TOUT << "\tCheckpoint: every " << m_Config.checkpointEvery << " frames to " << m_Config.checkpointFile << '\n';
+	}
+	if (m_Config.pinThreads || m_Config.firstTouch || m_Config.interleaveStationary || m_Config.hugePages != aligned_arena::page_mode::normal)
+	{
+		const char* pageNames[] = { "normal", "transparent huge", "explicit huge" };
+		TOUT << "\tMemory Placement: " << (m_Config.pinThreads ? "pinned threads, " : "") << (m_Config.firstTouch ? "first touch chunks, " : "")
+			<< (m_Config.interleaveStationary ? "interleaved stationary, " : "") << pageNames[static_cast<int>(m_Config.hugePages)] << " pages\n";
+	}
 	// Output enabled flags and matching info
 	TOUT << "Enabled Flags:\n";
 #ifdef _OUTPUT_ALL_
 	TOUT << "\t_OUTPUT_ALL_ : Output information about every single collision\n";
+	TOUT << "\t\tLog: " << (m_CollisionLog->path().empty() ? "stdout" : m_CollisionLog->path()) << '\n';
 #endif
 #ifdef _TIME_LOOPS_
 	TOUT << "\t_TIME_LOOPS_ : Output accurate time after each simulation 'frame'. Only accurate when _OUTPUT_ALL_,_USE_TL_ENGINE_ and _PAUSE_AFTER_EACH_FRAME_ are off\n";
@@ -352,163 +551,1270 @@ void simulator::output_beginning_message()
 #endif
 #ifdef _RANDOM_RADIUS_
 	TOUT << "\t_RANDOM_RADIUS_ : Randomises the radius of all circles\n";
-	TOUT << "\t\tRadius Range: " << CIRCLE_RADIUS_RANGE.x() << " --> " << CIRCLE_RADIUS_RANGE.y() << '\n';
+	TOUT << "\t\tRadius Range: " << m_Config.radiusRange.x() << " --> " << m_Config.radiusRange.y() << '\n';
+#endif
+#ifdef _TIME_THREADS_
+	TOUT << "\t_TIME_THREADS_ : Output how long each thread spent working each frame\n";
+#endif
+#ifdef _USE_SPATIAL_GRID_
+	TOUT << "\t_USE_SPATIAL_GRID_ : Uses a uniform grid broadphase instead of the x-axis line sweep\n";
+	TOUT << "\t\tGrid: " << m_GridCellsX << " x " << m_GridCellsY << " cells of size " << m_GridCellSize << '\n';
+#endif
+#ifdef _QUANTIZED_POSITIONS_
+	TOUT << "\t_QUANTIZED_POSITIONS_ : Line sweep reads 16-bit fixed point stationary positions, " << 1.0f / m_Quantizer.scale << " units per step\n";
+#endif
+#ifdef _EYTZINGER_SEARCH_
+	TOUT << "\t_EYTZINGER_SEARCH_ : Line sweeps start from a breadth first search tree over stationary x, " << m_StationarySearch.slots << " slots\n";
+#endif
+#ifdef _SWEPT_COLLISIONS_
+	TOUT << "\t_SWEPT_COLLISIONS_ : Moving circles stop at the first stationary circle along their path instead of being tested where they end up\n";
+#endif
+#ifdef _REMOVE_DESTROYED_CIRCLES_
+	TOUT << "\t_REMOVE_DESTROYED_CIRCLES_ : Circles are removed once their HP reaches 0 and the live count is shown each frame\n";
+#endif
+#ifdef _MOVING_COLLISIONS_
+	TOUT << "\t_MOVING_COLLISIONS_ : Moving circles also collide with each other using a parallel radix sort and line sweep\n";
+#endif
+#ifdef _RASTERISE_FRAMES_
+	TOUT << "\t_RASTERISE_FRAMES_ : Draws a density and HP heatmap of every circle over the thread pool\n";
+	TOUT << "\t\tImages: " << m_Config.rasterWidth << " x " << m_Config.rasterHeight << " every " << m_Config.rasterEvery << " frames to " << m_Config.rasterFile << "_<frame>.ppm\n";
+#endif
+#ifdef _PUBLISH_FRAME_STATE_
+	TOUT << "\t_PUBLISH_FRAME_STATE_ : Copies every circle at the end of each frame for consumers on their own thread\n";
+	#ifdef _RASTERISE_FRAMES_
+	TOUT << "\t\tHeatmap is drawn by the consumer thread and " << m_RasterPool->num_workers() << " workers of its own\n";
+	#endif
+#endif
+#ifdef _EXPORT_THREAD_STATS_
+	TOUT << "\t_EXPORT_THREAD_STATS_ : Writes per-thread timings and counters for every phase of every frame\n";
+	TOUT << "\t\tStats File: " << m_ThreadStats->path() << '\n';
+#endif
+#ifdef _PROFILE_ZONES_
+	TOUT << "\t_PROFILE_ZONES_ : Outputs a tree of where each frame's time went, added up over every thread\n";
+#endif
+#ifdef _RECORD_COLLISION_EVENTS_
+	TOUT << "\t_RECORD_COLLISION_EVENTS_ : Writes every collision as a binary record for offline analysis\n";
+	TOUT << "\t\tEvents File: " << m_CollisionEvents->path() << '\n';
+#endif
+#ifdef _MULTI_PROCESS_
+	TOUT << "\t_MULTI_PROCESS_ : " << m_Ranks->num_ranks() << " processes each simulate an x-slab, sharing stationary HP and passing moving circles between them\n";
+	for (auto rank = 0u; rank < m_Ranks->num_ranks(); ++rank)
+	{
+		TOUT << "\t\tRank " << rank << ": " << m_Ranks->slab_left(rank) << " <= x < " << m_Ranks->slab_right(rank) << '\n';
+	}
 #endif
 	TOUT << "Simulation Output:\n\n";
 }
 
-void simulator::check_collision(uint32_t threadIndex)
+bool simulator::is_reporting() const
 {
-	auto& pairedWorker = m_CollisionWorkers.at(threadIndex);
+	#ifdef _MULTI_PROCESS_
+	return m_Ranks->rank() == 0u;
+	#else
+	return true;
+	#endif
+}
 
-	while (true)
-	{
-		// Acquire the mutex
-		{
-			std::unique_lock<std::mutex> l(pairedWorker.worker.lock);
-			pairedWorker.worker.workReady.wait(l, [&]() { return !pairedWorker.work.complete; });
-		}
+size_t simulator::circle_data_size() const
+{
+	// Everything is in the arena, or mapped from the snapshot when resumed
+	const auto snapshotSize = m_Snapshot ? m_Snapshot->size() : 0u;
+	return m_Arena.bytes_allocated() + snapshotSize;
+}
 
-		// Do work
-		process_collision_sweep(&pairedWorker.work);
+void simulator::write_checkpoint()
+{
+	if (m_Config.checkpointEvery == 0u || m_Frame % m_Config.checkpointEvery != 0u)
+	{
+		return;
+	}
 
-		{
-			std::unique_lock<std::mutex> l(pairedWorker.worker.lock);
-			pairedWorker.work.complete = true;
-		}
+	// Workers are parked so nothing is changing
+	write_snapshot(m_Config.checkpointFile, m_Frame, m_Config, m_StationaryCollisionData, m_StationaryUniqueData, m_StationaryHP,
+		m_MovingCollisionData, m_MovingUniqueData);
+	TOUT << "Checkpoint at frame " << m_Frame << " written to " << m_Config.checkpointFile << '\n';
+}
 
-		pairedWorker.worker.workReady.notify_one();
+#ifdef _RASTERISE_FRAMES_
+void simulator::rasterise_frame()
+{
+	// m_Frame only counts this frame once it's finished
+	const auto frame = m_Frame + 1u;
+	if (frame % m_Config.rasterEvery != 0u)
+	{
+		return;
 	}
-	
+
+	#ifdef _PROFILE_ZONES_
+	profiler::scoped_zone zone("rasterise");
+	#endif
+	const auto start = std::chrono::steady_clock::now();
+	m_DensityRaster->draw(*m_ThreadPool, m_StationaryCollisionData, m_StationaryHP, m_MovingCollisionData);
+	write_raster(frame, start);
 }
 
-void simulator::process_collision_sweep(collision_work* work)
+#ifdef _PUBLISH_FRAME_STATE_
+void simulator::rasterise_state(const frame_state& state)
 {
-	for (auto i = 0u; i < work->mNumberOfCircles; ++i)
+	// Frames the consumer was too slow for never arrive, so the one due may have been skipped
+	if (state.frame < m_NextRasterFrame)
 	{
-		auto& mColData = work->mCirclesCol[i];
-		auto& mUniqueData = work->mCircleUnique[i];
+		return;
+	}
+	m_NextRasterFrame = (state.frame / m_Config.rasterEvery + 1u) * m_Config.rasterEvery;
 
-		// Pre-calculate
-#ifdef _RANDOM_RADIUS_
-		const float rightBound = mColData.position.x() + (2.0f * CIRCLE_RADIUS_RANGE.y());
-		const float leftBound = mColData.position.x() - (2.0f * CIRCLE_RADIUS_RANGE.y());
-#else
-		const float rightBound = mColData.position.x() + mColData.radius + mColData.radius;
-		const float leftBound = mColData.position.x() - mColData.radius - mColData.radius;
+	const auto start = std::chrono::steady_clock::now();
+	m_DensityRaster->draw(*m_RasterPool, state);
+	write_raster(state.frame, start);
+}
 #endif
 
-		// Perform line sweep binary search to find stationary circles that are overlapping
-		auto s = work->sCirclesCol;
-		auto e = work->sCirclesCol + NUM_STATIONARY_CIRCLES;
-		stationary_circle_data* circleFound;
-		bool found = false;
-		do
-		{
-			circleFound = s + (e - s) / 2;
-
-			
-			if (rightBound <= circleFound->position.x())
-			{
-				e = circleFound;
-			}
-			else if (leftBound >= circleFound->position.x())
-			{
-				s = circleFound;
-			}
-			else
-			{
-				found = true;
-			}
-		} while (!found && e - s > 1);
-		
-		if (found)
-		{
-			auto stationaryToStart = circleFound;
-			// Sweep right
-			while (rightBound > stationaryToStart->position.x() && stationaryToStart != work->sCirclesCol + NUM_STATIONARY_CIRCLES)
-			{
-				const Vector2f dxy = stationaryToStart->position - mColData.position;
-				const auto distance = dxy.norm();
-
-				// THIS BEING TRUE IS THE MOST EXPENSIVE PART 
-				if (distance < mColData.radius + stationaryToStart->radius)
-				{
-					
-					mUniqueData.hp -= 20;
-					{
-						std::unique_lock<std::mutex> l(work->sCirclesMutexes[stationaryToStart->uniqueIndex]);
-						work->sCirclesUnique[stationaryToStart->uniqueIndex].hp -= 20;
-					}
-					
-					// Reflect moving circles velocity
-					const auto norm = dxy.normalized();
-					mColData.velocity = mColData.velocity - 2.0f * norm * mColData.velocity.dot(norm);
-
-					#ifdef _OUTPUT_ALL_
-					
-					TOUT << mUniqueData.name << " HP: " << mUniqueData.hp << " hit " << work->sCirclesUnique[stationaryToStart->uniqueIndex].name << " HP: " << work->sCirclesUnique[stationaryToStart->uniqueIndex].hp << '\n';
-					
-					#endif
+void simulator::write_raster(uint32_t frame, std::chrono::steady_clock::time_point start)
+{
+	// Zero padded so the images sort in frame order
+	const auto frameNumber = std::to_string(frame);
+	const auto path = m_Config.rasterFile + '_' + std::string(frameNumber.size() < 6u ? 6u - frameNumber.size() : 0u, '0') + frameNumber + ".ppm";
+	m_DensityRaster->write_ppm(path);
 
-					// Track how many collision this thread handles
-					#ifdef _TRACK_COLLISIONS_
+	TOUT << "Rasterised " << m_DensityRaster->circles_drawn() << " circles to " << path << " in "
+		<< std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() << '\n';
+}
+#endif
 
-					work->numberOfCollisions++;
+#ifdef _REMOVE_DESTROYED_CIRCLES_
+void simulator::remove_destroyed_circles()
+{
+	// Threads found them in whatever order they took chunks, sorting makes the result the same every run
+	std::vector<uint32_t> destroyedStationary;
+	std::vector<uint32_t> destroyedMoving;
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		auto& work = work_for_thread(i);
+		destroyedStationary.insert(destroyedStationary.end(), work.destroyedStationary.begin(), work.destroyedStationary.end());
+		destroyedMoving.insert(destroyedMoving.end(), work.destroyedMoving.begin(), work.destroyedMoving.end());
+		work.destroyedStationary.clear();
+		work.destroyedMoving.clear();
+	}
 
-					#endif
-				}
-				
-				++stationaryToStart;
-			}
+	if (!destroyedStationary.empty())
+	{
+		std::sort(destroyedStationary.begin(), destroyedStationary.end());
+		remove_destroyed_stationary(destroyedStationary);
+	}
+	if (!destroyedMoving.empty())
+	{
+		std::sort(destroyedMoving.begin(), destroyedMoving.end());
+		remove_destroyed_moving(destroyedMoving);
+	}
+}
 
-			stationaryToStart = circleFound;
-			// Sweep left
-			while (stationaryToStart-- != work->sCirclesCol && leftBound < stationaryToStart->position.x())
-			{
-				const Vector2f dxy = stationaryToStart->position - mColData.position;
-				const auto distance = dxy.norm();
+void simulator::remove_already_destroyed()
+{
+	auto& work = work_for_thread(m_NumWorkers);
+	for (size_t i = 0; i < m_StationaryCollisionData.size(); ++i)
+	{
+		if (m_StationaryHP[m_StationaryCollisionData.uniqueIndex[i]].load(std::memory_order_relaxed) <= 0)
+		{
+			work.destroyedStationary.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	for (size_t i = 0; i < m_MovingCollisionData.size(); ++i)
+	{
+		if (m_MovingCollisionData.hp[i] <= 0)
+		{
+			work.destroyedMoving.push_back(static_cast<uint32_t>(i));
+		}
+	}
 
-				// THIS BEING TRUE IS THE MOST EXPENSIVE PART 
-				if (distance < mColData.radius + stationaryToStart->radius)
-				{
-					mUniqueData.hp -= 20;
-					{
-						std::unique_lock<std::mutex> l(work->sCirclesMutexes[stationaryToStart->uniqueIndex]);
-						work->sCirclesUnique[stationaryToStart->uniqueIndex].hp -= 20;
-					}
+	remove_destroyed_circles();
+}
 
-					// Reflect moving circles velocity
-					const auto norm = dxy.normalized();
-					mColData.velocity = mColData.velocity - 2.0f * norm * mColData.velocity.dot(norm);
+void simulator::remove_destroyed_stationary(const std::vector<uint32_t>& destroyed)
+{
+	auto& sColData = m_StationaryCollisionData;
+	const auto count = sColData.size();
+
+	// Each run of survivors between two destroyed circles moves down by how many were destroyed before it
+	// Order is kept so x stays sorted and the sweep never needs sorting again. Nothing before the first destroyed circle moves
+	// HP and colors are by unique index so they stay where they are
+	size_t write = destroyed.front();
+	for (size_t d = 0; d < destroyed.size(); ++d)
+	{
+		const size_t begin = destroyed[d] + 1u;
+		const size_t end = d + 1u < destroyed.size() ? destroyed[d + 1u] : count;
+		const auto shift = [&](auto* array)
+		{
+			std::copy(array + begin, array + end, array + write);
+		};
+
+		shift(sColData.x);
+		shift(sColData.y);
+		shift(sColData.radius);
+		shift(sColData.uniqueIndex);
+		#ifdef _QUANTIZED_POSITIONS_
+		if (m_StationaryPacked != nullptr)
+		{
+			shift(m_StationaryPacked);
+		}
+		#endif
 
-					#ifdef _OUTPUT_ALL_
-					TOUT << mUniqueData.name << " HP: " << mUniqueData.hp << " hit " << work->sCirclesUnique[stationaryToStart->uniqueIndex].name << " HP: " << work->sCirclesUnique[stationaryToStart->uniqueIndex].hp << '\n';
-					#endif
+		write += end - begin;
+	}
+	sColData.count = write;
 
-					// Track how many collision this thread handles
-					#ifdef _TRACK_COLLISIONS_
+	#ifdef _PUBLISH_FRAME_STATE_
+	++m_StationaryVersion;
+	#endif
 
-					work->numberOfCollisions++;
+	#ifdef _EYTZINGER_SEARCH_
+	// Tree holds the old midpoints. Not built yet when removing at startup
+	if (m_StationarySearch.nodes != nullptr)
+	{
+		build_stationary_search();
+	}
+	#endif
 
-					#endif
-				}
-			}
-			
-		}
+	#ifdef _USE_SPATIAL_GRID_
+	// Grid holds indexes into the arrays that just moved. Not built yet when removing at startup
+	if (m_StationaryGridCellStarts != nullptr)
+	{
+		build_stationary_grid();
 	}
-}
+	#endif
 
-#ifdef _USE_TL_ENGINE_
-void simulator::update_tl(float deltaTime)
+	#ifdef _USE_TL_ENGINE_
+	// Models follow the arrays, so everything from the first destroyed circle on moves too
+	for (auto index = static_cast<size_t>(destroyed.front()); index < sColData.size(); ++index)
+	{
+		m_StationaryCircleModels.at(index)->SetPosition(sColData.x[index], sColData.y[index], 0.0f);
+		#ifdef _RANDOM_RADIUS_
+		m_StationaryCircleModels.at(index)->ResetScale();
+		m_StationaryCircleModels.at(index)->Scale(0.5f * sColData.radius[index]);
+		#endif
+	}
+	while (m_StationaryCircleModels.size() > sColData.size())
+	{
+		m_StationaryMesh->RemoveModel(m_StationaryCircleModels.back());
+		m_StationaryCircleModels.pop_back();
+	}
+	#endif
+}
+
+void simulator::remove_destroyed_moving(const std::vector<uint32_t>& destroyed)
+{
+	auto& mColData = m_MovingCollisionData;
+	const auto count = mColData.size();
+	const auto remaining = static_cast<uint32_t>(count - destroyed.size());
+
+	// Destroyed circles below remaining leave holes. Survivors from remaining up fill them in order, skipping
+	// any that were destroyed too, so only as many circles move as were destroyed
+	m_MovingMoves.clear();
+	auto destroyedAbove = std::lower_bound(destroyed.begin(), destroyed.end(), remaining);
+	auto from = remaining;
+	for (auto hole = destroyed.begin(); hole != destroyed.end() && *hole < remaining; ++hole)
+	{
+		while (destroyedAbove != destroyed.end() && *destroyedAbove == from)
+		{
+			++destroyedAbove;
+			++from;
+		}
+
+		moving_circle_move move;
+		move.from = from++;
+		move.to = *hole;
+		m_MovingMoves.push_back(move);
+	}
+
+	if (!m_MovingMoves.empty())
+	{
+		run_phase(work_phase::fill_destroyed);
+	}
+	mColData.count = remaining;
+	m_MovingUniqueData.count = remaining;
+
+	#ifdef _USE_TL_ENGINE_
+	// Models are moved to their circles every frame, only the size needs fixing up
+	#ifdef _RANDOM_RADIUS_
+	for (const auto& move : m_MovingMoves)
+	{
+		m_MovingCirclesModels.at(move.to)->ResetScale();
+		m_MovingCirclesModels.at(move.to)->Scale(0.5f * mColData.radius[move.to]);
+	}
+	#endif
+	while (m_MovingCirclesModels.size() > mColData.size())
+	{
+		m_MovingMesh->RemoveModel(m_MovingCirclesModels.back());
+		m_MovingCirclesModels.pop_back();
+	}
+	#endif
+}
+
+void simulator::fill_destroyed_moving(collision_work* work)
+{
+	auto& mColData = m_MovingCollisionData;
+
+	// Every move reads above remaining and writes below it, so threads can never touch the same circle
+	uint32_t begin, end;
+	thread_range(work->threadIndex, static_cast<uint32_t>(m_MovingMoves.size()), begin, end);
+	for (auto i = begin; i < end; ++i)
+	{
+		const auto from = m_MovingMoves[i].from;
+		const auto to = m_MovingMoves[i].to;
+
+		mColData.x[to] = mColData.x[from];
+		mColData.y[to] = mColData.y[from];
+		mColData.velocityX[to] = mColData.velocityX[from];
+		mColData.velocityY[to] = mColData.velocityY[from];
+		mColData.radius[to] = mColData.radius[from];
+		mColData.hp[to] = mColData.hp[from];
+		mColData.id[to] = mColData.id[from];
+		m_MovingUniqueData.color[to] = m_MovingUniqueData.color[from];
+	}
+}
+#endif
+
+#ifdef _MULTI_PROCESS_
+uint32_t simulator::migrate_moving_circles()
+{
+	auto& mColData = m_MovingCollisionData;
+	auto& mUniqueData = m_MovingUniqueData;
+	const auto rank = m_Ranks->rank();
+	const float left = m_Ranks->slab_left(rank);
+	const float right = m_Ranks->slab_right(rank);
+
+	// Circles staying are packed down over the ones leaving. Workers are parked so this is the only thread touching them
+	size_t write = 0u;
+	for (size_t i = 0; i < mColData.size(); ++i)
+	{
+		if (left <= mColData.x[i] && mColData.x[i] < right)
+		{
+			mColData.x[write] = mColData.x[i];
+			mColData.y[write] = mColData.y[i];
+			mColData.velocityX[write] = mColData.velocityX[i];
+			mColData.velocityY[write] = mColData.velocityY[i];
+			mColData.radius[write] = mColData.radius[i];
+			mColData.hp[write] = mColData.hp[i];
+			mColData.id[write] = mColData.id[i];
+			mUniqueData.color[write] = mUniqueData.color[i];
+			++write;
+			continue;
+		}
+
+		migrating_circle circle;
+		circle.x = mColData.x[i];
+		circle.y = mColData.y[i];
+		circle.velocityX = mColData.velocityX[i];
+		circle.velocityY = mColData.velocityY[i];
+		circle.radius = mColData.radius[i];
+		circle.hp = mColData.hp[i];
+		circle.id = mColData.id[i];
+		circle.color = mUniqueData.color[i];
+		(circle.x < left ? m_LeavingLeft : m_LeavingRight).push_back(circle);
+	}
+	const auto leaving = static_cast<uint32_t>(m_LeavingLeft.size() + m_LeavingRight.size());
+
+	// Arrays have room for every moving circle in the scene, so there's always space for what arrives
+	m_Ranks->exchange(m_LeavingLeft, m_LeavingRight, m_Arrived);
+	for (const auto& circle : m_Arrived)
+	{
+		mColData.x[write] = circle.x;
+		mColData.y[write] = circle.y;
+		mColData.velocityX[write] = circle.velocityX;
+		mColData.velocityY[write] = circle.velocityY;
+		mColData.radius[write] = circle.radius;
+		mColData.hp[write] = circle.hp;
+		mColData.id[write] = circle.id;
+		mUniqueData.color[write] = circle.color;
+		++write;
+	}
+	mColData.count = write;
+	mUniqueData.count = write;
+
+	return leaving;
+}
+
+void simulator::output_rank_frame(const rank_frame_stats& stats, float timeToProcess)
+{
+	m_Ranks->end_frame(m_Frame, stats);
+	if (!is_reporting())
+	{
+		return;
+	}
+
+	#ifdef _TIME_LOOPS_
+	// Halos overlap so the circles each rank has don't add up to the scene
+	#ifdef _TRACK_COLLISIONS_
+	uint32_t totalCollisions = 0u;
+	for (auto rank = 0u; rank < m_Ranks->num_ranks(); ++rank)
+	{
+		totalCollisions += m_Ranks->frame_stats(rank, m_Frame).collisions;
+	}
+	TOUT << "Processed " << m_Config.num_circles() << " circles in " << timeToProcess << " Total Collisions: " << totalCollisions << " Dispatch/Join: " << m_ThreadPool->overhead_time() << '\n';
+	#else
+	TOUT << "Processed " << m_Config.num_circles() << " circles in " << timeToProcess << " Dispatch/Join: " << m_ThreadPool->overhead_time() << '\n';
+	#endif
+
+	for (auto rank = 0u; rank < m_Ranks->num_ranks(); ++rank)
+	{
+		const auto& rankStats = m_Ranks->frame_stats(rank, m_Frame);
+		TOUT << "\tRank " << rank << ": " << rankStats.movingCircles << " moving, " << rankStats.migrated << " left, collide " << rankStats.collideTime
+			<< " exchange " << rankStats.exchangeTime << '\n';
+	}
+	#else
+	(void)timeToProcess;
+	#endif
+}
+#endif
+
+#ifdef _TIME_THREADS_
+void simulator::output_thread_times()
+{
+	float slowest = 0.0f;
+	float total = 0.0f;
+
+	ThreadStream out(std::cout);
+	out << "\tThread Busy Times:";
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		const auto busyTime = work_for_thread(i).busyTime;
+		out << ' ' << busyTime;
+
+		slowest = std::max(slowest, busyTime);
+		total += busyTime;
+	}
+
+	// 1.0 is perfectly balanced
+	out << " Slowest/Average: " << slowest / (total / static_cast<float>(m_NumWorkers + 1)) << '\n';
+}
+#endif
+
+void simulator::run_phase(work_phase phase)
+{
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		work_for_thread(i).phase = phase;
+	}
+
+	#ifdef _PROFILE_ZONES_
+	profiler::scoped_zone phaseZone(work_phase_name(phase));
+	m_PhaseZone = phaseZone.id();
+	#endif
+
+	// Main thread does its share as the last index
+	m_ThreadPool->run([this](uint32_t threadIndex)
+	{
+		#ifdef _PROFILE_ZONES_
+		profiler::scoped_zone zone(m_PhaseZone, "work");
+		#endif
+		process_phase(&work_for_thread(threadIndex));
+	});
+
+	#ifdef _PROFILE_ZONES_
+	// Until the last thread started, and the longest any thread sat waiting for the others
+	auto lastStart = m_ThreadPool->last_dispatch_time();
+	auto firstEnd = m_ThreadPool->last_join_time();
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		lastStart = std::max(lastStart, m_ThreadPool->job_start_time(i));
+		firstEnd = std::min(firstEnd, m_ThreadPool->job_end_time(i));
+	}
+	profiler::add(profiler::child_zone(m_PhaseZone, "dispatch"), profiler::to_ticks(lastStart - m_ThreadPool->last_dispatch_time()));
+	profiler::add(profiler::child_zone(m_PhaseZone, "join"), profiler::to_ticks(m_ThreadPool->last_join_time() - firstEnd));
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	record_phase_stats(phase);
+	#endif
+}
+
+#ifdef _EXPORT_THREAD_STATS_
+void simulator::record_phase_stats(work_phase phase)
+{
+	const auto seconds = [](thread_pool::clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	};
+
+	const auto dispatch = m_ThreadPool->last_dispatch_time();
+	const auto join = m_ThreadPool->last_join_time();
+
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		auto& work = work_for_thread(i);
+		const auto start = m_ThreadPool->job_start_time(i);
+		const auto end = m_ThreadPool->job_end_time(i);
+
+		thread_phase_record record;
+		record.frame = m_Frame;
+		record.phase = phase;
+		record.threadIndex = i;
+		record.dispatchTime = seconds(dispatch - m_ThreadStatsStart);
+		record.wakeLatency = seconds(start - dispatch);
+		record.computeTime = seconds(end - start);
+		record.idleTime = seconds(join - end);
+		record.candidatesTested = work.candidatesTested;
+		record.hits = work.phaseHits;
+		m_ThreadStats->add(record);
+
+		work.candidatesTested = 0u;
+		work.phaseHits = 0u;
+	}
+}
+#endif
+
+void simulator::process_phase(collision_work* work)
+{
+	#ifdef _TIME_THREADS_
+	const auto start = std::chrono::steady_clock::now();
+	#endif
+
+	switch (work->phase)
+	{
+	case work_phase::collide_stationary:
+		// Keep taking chunks until there are none left. Threads that finish early just take more
+		while (m_Config.firstTouch ? next_slice_chunk(work->threadIndex, work->mFirstCircle, work->mNumberOfCircles)
+			: next_chunk(m_MovingCollisionData.size(), work->mFirstCircle, work->mNumberOfCircles))
+		{
+			#if defined(_SWEPT_COLLISIONS_)
+			// Moves the circles itself as they stop at whatever they hit
+			process_collision_swept(work);
+			#else
+			{
+				#ifdef _PROFILE_ZONES_
+				profiler::scoped_zone zone("integrate");
+				#endif
+				integrate_positions(work);
+			}
+
+			#ifdef _USE_SPATIAL_GRID_
+			process_collision_grid(work);
+			#else
+			process_collision_sweep(work);
+			#endif
+			#endif
+		}
+		break;
+	#ifdef _MOVING_COLLISIONS_
+	case work_phase::sort_histogram:
+		radix_histogram(work);
+		break;
+	case work_phase::sort_scatter:
+		radix_scatter(work);
+		break;
+	case work_phase::collide_moving:
+		process_moving_sweep(work);
+		break;
+	#endif
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	case work_phase::fill_destroyed:
+		fill_destroyed_moving(work);
+		break;
+	#endif
+	default:
+		break;
+	}
+
+	#ifdef _TIME_THREADS_
+	work->busyTime += std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	#endif
+}
+
+bool simulator::next_chunk(size_t count, size_t& first, size_t& number)
+{
+	first = m_NextChunk.fetch_add(m_Config.chunkSize, std::memory_order_relaxed);
+	if (first >= count)
+	{
+		return false;
+	}
+
+	number = std::min<size_t>(m_Config.chunkSize, count - first);
+	return true;
+}
+
+void simulator::reset_chunk_slices(uint32_t count)
+{
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		uint32_t begin;
+		thread_range(i, count, begin, m_ChunkSlices[i].end);
+		m_ChunkSlices[i].next.store(begin, std::memory_order_relaxed);
+	}
+}
+
+bool simulator::next_slice_chunk(uint32_t threadIndex, size_t& first, size_t& number)
+{
+	// Own slice first, then the next thread along that still has some left
+	for (auto i = 0u; i <= m_NumWorkers; ++i)
+	{
+		auto& slice = m_ChunkSlices[(threadIndex + i) % (m_NumWorkers + 1u)];
+		if (slice.next.load(std::memory_order_relaxed) >= slice.end)
+		{
+			continue;
+		}
+
+		first = slice.next.fetch_add(m_Config.chunkSize, std::memory_order_relaxed);
+		if (first < slice.end)
+		{
+			number = std::min<size_t>(m_Config.chunkSize, slice.end - first);
+			return true;
+		}
+	}
+	return false;
+}
+
+void simulator::pin_threads()
+{
+	// Each rank pins to its own CPUs rather than every rank piling onto the first few
+	uint32_t firstCpu = 0u;
+	#ifdef _MULTI_PROCESS_
+	firstCpu = m_Ranks->rank() * (m_NumWorkers + 1u);
+	#endif
+
+	std::atomic<bool> allPinned = { true };
+	m_ThreadPool->run([&](uint32_t threadIndex)
+	{
+		if (!pin_current_thread(firstCpu + threadIndex))
+		{
+			allPinned.store(false, std::memory_order_relaxed);
+		}
+	});
+	if (!allPinned.load())
+	{
+		throw std::runtime_error("Could not pin threads to CPUs");
+	}
+}
+
+collision_work& simulator::work_for_thread(uint32_t threadIndex)
+{
+	return m_CollisionWork.at(threadIndex);
+}
+
+void simulator::thread_range(uint32_t threadIndex, uint32_t count, uint32_t& begin, uint32_t& end) const
+{
+	const uint64_t numThreads = m_NumWorkers + 1u;
+	begin = static_cast<uint32_t>(count * static_cast<uint64_t>(threadIndex) / numThreads);
+	end = static_cast<uint32_t>(count * static_cast<uint64_t>(threadIndex + 1u) / numThreads);
+}
+
+void simulator::integrate_positions(collision_work* work)
+{
+	auto& mColData = *work->mCirclesCol;
+	collision_kernels::integrate(mColData.x, mColData.y, mColData.velocityX, mColData.velocityY, work->mFirstCircle, work->mNumberOfCircles, m_Config.timeStep);
+}
+
+void simulator::process_collision_sweep(collision_work* work)
+{
+	const auto& sColData = *work->sCirclesCol;
+	const auto& mColData = *work->mCirclesCol;
+	const auto numStationary = sColData.size();
+
+#ifdef _RANDOM_RADIUS_
+	const float maxCollisionDistance = m_Config.max_collision_distance();
+#endif
+#ifdef _QUANTIZED_POSITIONS_
+	const float maxStationaryRadius = 0.5f * m_Config.max_collision_distance();
+#endif
+
+#ifdef _PROFILE_ZONES_
+	// A zone per circle would cost more than the sweep, so each is summed over the chunk
+	// Each read ends one part and starts the next, so the little in between is counted as search
+	const auto searchZone = profiler::child_zone(profiler::current_zone(), "search");
+	const auto sweepZone = profiler::child_zone(profiler::current_zone(), "sweep");
+	const auto resolveZone = profiler::child_zone(profiler::current_zone(), "resolve");
+	profiler::ticks searchTime = 0u, sweepTime = 0u, resolveTime = 0u;
+	uint32_t numResolved = 0u;
+	auto& hits = work->sweepHits;
+	auto partStart = profiler::now();
+#endif
+
+	for (auto i = work->mFirstCircle; i < work->mFirstCircle + work->mNumberOfCircles; ++i)
+	{
+		const Vector2f mPosition = mColData.position(i);
+		const float mRadius = mColData.radius[i];
+
+		// Pre-calculate
+#ifdef _RANDOM_RADIUS_
+		const float rightBound = mPosition.x() + maxCollisionDistance;
+		const float leftBound = mPosition.x() - maxCollisionDistance;
+#else
+		const float rightBound = mPosition.x() + mRadius + mRadius;
+		const float leftBound = mPosition.x() - mRadius - mRadius;
+#endif
+
+		// Perform line sweep binary search to find stationary circles that are overlapping
+		size_t circleFound;
+		const auto found = numStationary != 0u && find_stationary_sweep_start(sColData, leftBound, rightBound, circleFound);
+		#ifdef _PROFILE_ZONES_
+		const auto sweepStart = profiler::now();
+		searchTime += sweepStart - partStart;
+		partStart = sweepStart;
+		#endif
+		if (found)
+		{
+			// Resolving never changes anything the sweep reads, so hits can wait until it's done in the same order
+			const auto onHit = [&](size_t stationaryIndex)
+			{
+				#ifdef _PROFILE_ZONES_
+				hits.push_back(static_cast<uint32_t>(stationaryIndex));
+				#else
+				resolve_collision(work, i, stationaryIndex, sColData.position(stationaryIndex) - mPosition);
+				#endif
+			};
+
+			#ifdef _QUANTIZED_POSITIONS_
+			const auto candidates = collision_kernels::sweep_right_quantized(sColData.x, sColData.y, sColData.radius, m_StationaryPacked, m_Quantizer, numStationary, circleFound, mPosition.x(), mPosition.y(), mRadius, maxStationaryRadius, rightBound, onHit)
+				+ collision_kernels::sweep_left_quantized(sColData.x, sColData.y, sColData.radius, m_StationaryPacked, m_Quantizer, circleFound, mPosition.x(), mPosition.y(), mRadius, maxStationaryRadius, leftBound, onHit);
+			#else
+			const auto candidates = collision_kernels::sweep_right(sColData.x, sColData.y, sColData.radius, numStationary, circleFound, mPosition.x(), mPosition.y(), mRadius, rightBound, onHit)
+				+ collision_kernels::sweep_left(sColData.x, sColData.y, sColData.radius, circleFound, mPosition.x(), mPosition.y(), mRadius, leftBound, onHit);
+			#endif
+
+			#ifdef _EXPORT_THREAD_STATS_
+			work->candidatesTested += candidates;
+			#else
+			(void)candidates;
+			#endif
+
+			#ifdef _PROFILE_ZONES_
+			partStart = profiler::now();
+			sweepTime += partStart - sweepStart;
+
+			if (!hits.empty())
+			{
+				for (const auto stationaryIndex : hits)
+				{
+					resolve_collision(work, i, stationaryIndex, sColData.position(stationaryIndex) - mPosition);
+				}
+				numResolved += static_cast<uint32_t>(hits.size());
+				hits.clear();
+
+				const auto resolveEnd = profiler::now();
+				resolveTime += resolveEnd - partStart;
+				partStart = resolveEnd;
+			}
+			#endif
+		}
+	}
+
+#ifdef _PROFILE_ZONES_
+	// Calls are circles, or collisions for resolve
+	profiler::add(searchZone, searchTime, static_cast<uint32_t>(work->mNumberOfCircles));
+	profiler::add(sweepZone, sweepTime, static_cast<uint32_t>(work->mNumberOfCircles));
+	if (numResolved != 0u)
+	{
+		profiler::add(resolveZone, resolveTime, numResolved);
+	}
+#endif
+}
+
+bool simulator::find_stationary_sweep_start(const stationary_collision_array& sColData, float leftBound, float rightBound, size_t& circleFound) const
+{
+	#if defined(_MULTI_PROCESS_)
+	// Searched as if this rank had every stationary circle, so the sweeps start where they would in one process
+	return collision_kernels::find_sweep_start_in_part(sColData.x, m_FirstStationary, sColData.size(), m_Config.numStationaryCircles, leftBound, rightBound, circleFound);
+	#elif defined(_EYTZINGER_SEARCH_)
+	(void)sColData;
+	return m_StationarySearch.find(leftBound, rightBound, circleFound);
+	#else
+	return collision_kernels::find_sweep_start(sColData.x, sColData.size(), leftBound, rightBound, circleFound);
+	#endif
+}
+
+#ifdef _EYTZINGER_SEARCH_
+void simulator::build_stationary_search()
+{
+	const auto& sColData = m_StationaryCollisionData;
+
+	// Fewer circles never need more slots, so the first build's nodes are reused as circles are removed
+	auto* nodes = m_StationarySearch.nodes;
+	if (nodes == nullptr)
+	{
+		const auto slots = collision_kernels::sweep_search_index::slots_for(sColData.size());
+		nodes = m_Arena.allocate<collision_kernels::search_node>(slots, interleave_alignment(m_Config));
+		if (m_Config.interleaveStationary)
+		{
+			interleave_pages(m_Config, *m_ThreadPool, nodes, slots * sizeof(collision_kernels::search_node));
+		}
+	}
+	m_StationarySearch.build(sColData.x, sColData.size(), nodes);
+}
+#endif
+
+#ifdef _QUANTIZED_POSITIONS_
+void simulator::quantize_stationary_positions()
+{
+	const auto& sColData = m_StationaryCollisionData;
+	m_Quantizer = collision_kernels::position_quantizer::for_range(m_Config.xSpawnRange.x(), m_Config.xSpawnRange.y(), m_Config.ySpawnRange.x(), m_Config.ySpawnRange.y());
+
+	m_StationaryPacked = m_Arena.allocate<uint32_t>(sColData.size(), interleave_alignment(m_Config));
+	if (m_Config.interleaveStationary)
+	{
+		interleave_pages(m_Config, *m_ThreadPool, m_StationaryPacked, sColData.size() * sizeof(uint32_t));
+	}
+	for (size_t i = 0; i < sColData.size(); ++i)
+	{
+		m_StationaryPacked[i] = m_Quantizer.pack(sColData.x[i], sColData.y[i]);
+	}
+}
+#endif
+
+#ifdef _SWEPT_COLLISIONS_
+void simulator::process_collision_swept(collision_work* work)
+{
+	const auto& sColData = *work->sCirclesCol;
+	auto& mColData = *work->mCirclesCol;
+	const auto numStationary = sColData.size();
+	const float maxCollisionDistance = m_Config.max_collision_distance();
+
+	for (auto i = work->mFirstCircle; i < work->mFirstCircle + work->mNumberOfCircles; ++i)
+	{
+		Vector2f mPosition = mColData.position(i);
+		const float mRadius = mColData.radius[i];
+
+		// Motion left this frame, in frames. Each bounce moves to the first contact then carries on with the new velocity
+		float remaining = m_Config.timeStep;
+		for (auto bounce = 0u; bounce < SWEPT_MAX_BOUNCES && remaining > 0.0f; ++bounce)
+		{
+			const Vector2f motion = mColData.velocity(i) * remaining;
+
+			if (motion.x() == 0.0f && motion.y() == 0.0f)
+			{
+				break;
+			}
+
+			// Anything touched along the way is within touching distance of the x range the motion covers
+			const float leftBound = std::min(mPosition.x(), mPosition.x() + motion.x()) - maxCollisionDistance;
+			const float rightBound = std::max(mPosition.x(), mPosition.x() + motion.x()) + maxCollisionDistance;
+
+			// Earliest contact. Ties go to the lowest index so the result doesn't depend on the walk order
+			float firstTime = 2.0f;
+			size_t firstHit = numStationary;
+
+			size_t circleFound;
+			if (numStationary != 0u && find_stationary_sweep_start(sColData, leftBound, rightBound, circleFound))
+			{
+				// The kernels only pass on circles the motion touches, the square root is left for those
+				const auto onHit = [&](size_t stationaryIndex)
+				{
+					float time;
+					if (collision_kernels::time_of_impact(mPosition.x(), mPosition.y(), motion.x(), motion.y(),
+						sColData.x[stationaryIndex], sColData.y[stationaryIndex], mRadius + sColData.radius[stationaryIndex], time)
+						&& (time < firstTime || (time == firstTime && stationaryIndex < firstHit)))
+					{
+						firstTime = time;
+						firstHit = stationaryIndex;
+					}
+				};
+
+				const auto candidates = collision_kernels::swept_right(sColData.x, sColData.y, sColData.radius, numStationary, circleFound, mPosition.x(), mPosition.y(), motion.x(), motion.y(), mRadius, rightBound, onHit)
+					+ collision_kernels::swept_left(sColData.x, sColData.y, sColData.radius, circleFound, mPosition.x(), mPosition.y(), motion.x(), motion.y(), mRadius, leftBound, onHit);
+
+				#ifdef _EXPORT_THREAD_STATS_
+				work->candidatesTested += candidates;
+				#else
+				(void)candidates;
+				#endif
+			}
+
+			if (firstHit == numStationary)
+			{
+				mPosition += motion;
+				break;
+			}
+
+			// Move to the contact, bounce, then sweep whatever is left of the frame
+			mPosition += motion * firstTime;
+			remaining *= 1.0f - firstTime;
+			resolve_collision(work, i, firstHit, sColData.position(firstHit) - mPosition);
+		}
+
+		mColData.x[i] = mPosition.x();
+		mColData.y[i] = mPosition.y();
+	}
+}
+#endif
+
+void simulator::resolve_collision(collision_work* work, size_t movingIndex, size_t stationaryIndex, const Vector2f& dxy)
+{
+	auto& mColData = *work->mCirclesCol;
+	const auto uniqueIndex = work->sCirclesCol->uniqueIndex[stationaryIndex];
+
+	const auto movingHP = mColData.hp[movingIndex] -= 20;
+	// Only the subtract needs to be atomic, nothing else is ordered against it
+	const auto stationaryHP = work->sCirclesHP[uniqueIndex].fetch_sub(20, std::memory_order_relaxed) - 20;
+
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	// Only the hit that takes HP to 0 records it, so each circle is recorded once however many threads hit it
+	if (movingHP <= 0 && movingHP > -20)
+	{
+		work->destroyedMoving.push_back(static_cast<uint32_t>(movingIndex));
+	}
+	if (stationaryHP <= 0 && stationaryHP > -20)
+	{
+		work->destroyedStationary.push_back(static_cast<uint32_t>(stationaryIndex));
+	}
+	#endif
+
+	// Reflect moving circles velocity
+	const auto norm = dxy.normalized();
+	const Vector2f velocity = mColData.velocity(movingIndex);
+	mColData.set_velocity(movingIndex, velocity - 2.0f * norm * velocity.dot(norm));
+
+	#ifdef _OUTPUT_ALL_
+	collision_log_record record;
+	record.frame = m_Frame;
+	record.a = mColData.id[movingIndex];
+	record.aHP = movingHP;
+	record.b = uniqueIndex;
+	record.bHP = stationaryHP;
+	m_CollisionLog->log(work->threadIndex, record);
+	#endif
+
+	#ifdef _RECORD_COLLISION_EVENTS_
+	collision_event event;
+	event.frame = m_Frame;
+	event.movingId = mColData.id[movingIndex];
+	event.otherId = uniqueIndex;
+	event.kind = collision_event_kind::moving_stationary;
+	event.normalX = norm.x();
+	event.normalY = norm.y();
+	event.movingHP = movingHP;
+	event.otherHP = stationaryHP;
+	m_CollisionEvents->record(work->threadIndex, event);
+	#endif
+
+	(void)movingHP;
+	(void)stationaryHP;
+
+	// Track how many collision this thread handles
+	#ifdef _TRACK_COLLISIONS_
+
+	work->numberOfCollisions++;
+
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	work->phaseHits++;
+	#endif
+}
+
+#ifdef _USE_SPATIAL_GRID_
+void simulator::build_stationary_grid()
+{
+	const auto numStationary = m_StationaryCollisionData.size();
+
+	m_GridCellSize = m_Config.max_collision_distance();
+	m_GridCellsX = static_cast<uint32_t>(std::ceil((m_Config.xSpawnRange.y() - m_Config.xSpawnRange.x()) / m_GridCellSize));
+	m_GridCellsY = static_cast<uint32_t>(std::ceil((m_Config.ySpawnRange.y() - m_Config.ySpawnRange.x()) / m_GridCellSize));
+	const auto numCells = static_cast<size_t>(m_GridCellsX) * m_GridCellsY;
+
+	// Works out which cell a stationary circle lives in
+	const auto cellOf = [this](size_t i)
+	{
+		const auto cellX = std::min(static_cast<uint32_t>((m_StationaryCollisionData.x[i] - m_Config.xSpawnRange.x()) / m_GridCellSize), m_GridCellsX - 1u);
+		const auto cellY = std::min(static_cast<uint32_t>((m_StationaryCollisionData.y[i] - m_Config.ySpawnRange.x()) / m_GridCellSize), m_GridCellsY - 1u);
+		return static_cast<size_t>(cellY) * m_GridCellsX + cellX;
+	};
+
+	// Counting sort. First count how many circles land in each cell
+	// Rebuilt when circles are removed, which only ever needs less space
+	if (m_StationaryGridCellStarts == nullptr)
+	{
+		m_StationaryGridCellStarts = m_Arena.allocate<uint32_t>(numCells + 1);
+		m_StationaryGridIndices = m_Arena.allocate<uint32_t>(numStationary);
+	}
+	std::fill(m_StationaryGridCellStarts, m_StationaryGridCellStarts + numCells + 1, 0u);
+	for (auto i = 0u; i < numStationary; ++i)
+	{
+		++m_StationaryGridCellStarts[cellOf(i) + 1];
+	}
+
+	// Prefix sum turns counts into start offsets
+	for (size_t i = 1; i <= numCells; ++i)
+	{
+		m_StationaryGridCellStarts[i] += m_StationaryGridCellStarts[i - 1];
+	}
+
+	// Then scatter. Walking in sorted order keeps each cell sorted by x
+	std::vector<uint32_t> cellCursor(m_StationaryGridCellStarts, m_StationaryGridCellStarts + numCells);
+	for (auto i = 0u; i < numStationary; ++i)
+	{
+		m_StationaryGridIndices[cellCursor[cellOf(i)]++] = i;
+	}
+}
+
+void simulator::process_collision_grid(collision_work* work)
+{
+	const auto& sColData = *work->sCirclesCol;
+	const auto& mColData = *work->mCirclesCol;
+
+	const Vector2f gridOrigin(m_Config.xSpawnRange.x(), m_Config.ySpawnRange.x());
+	const float cellSize = m_GridCellSize;
+	const int64_t cellsX = m_GridCellsX;
+	const int64_t cellsY = m_GridCellsY;
+
+	for (auto i = work->mFirstCircle; i < work->mFirstCircle + work->mNumberOfCircles; ++i)
+	{
+		const Vector2f mPosition = mColData.position(i);
+		const float mRadius = mColData.radius[i];
+
+		// Find the cell the moving circle is in. Can be outside the grid as moving circles leave the spawn range
+		const auto cellX = static_cast<int64_t>(std::floor((mPosition.x() - gridOrigin.x()) / cellSize));
+		const auto cellY = static_cast<int64_t>(std::floor((mPosition.y() - gridOrigin.y()) / cellSize));
+
+		// Clamp the 3x3 neighbourhood to the grid. If it is fully outside there is nothing to hit
+		const auto minX = std::max<int64_t>(cellX - 1, 0);
+		const auto maxX = std::min<int64_t>(cellX + 1, cellsX - 1);
+		const auto minY = std::max<int64_t>(cellY - 1, 0);
+		const auto maxY = std::min<int64_t>(cellY + 1, cellsY - 1);
+		if (minX > maxX || minY > maxY)
+		{
+			continue;
+		}
+
+		for (auto y = minY; y <= maxY; ++y)
+		{
+			// Cells in a row are contiguous so the whole row of the neighbourhood is one range
+			const auto rowStart = y * cellsX;
+			const auto start = work->sGridCellStarts[rowStart + minX];
+			const auto end = work->sGridCellStarts[rowStart + maxX + 1];
+
+			#ifdef _EXPORT_THREAD_STATS_
+			work->candidatesTested += end - start;
+			#endif
+
+			for (auto g = start; g < end; ++g)
+			{
+				const auto stationaryIndex = work->sGridIndices[g];
+
+				const Vector2f dxy = sColData.position(stationaryIndex) - mPosition;
+
+				if (collision_kernels::overlaps(dxy.x(), dxy.y(), mRadius + sColData.radius[stationaryIndex]))
+				{
+					resolve_collision(work, i, stationaryIndex, dxy);
+				}
+			}
+		}
+	}
+}
+#endif
+
+#ifdef _MOVING_COLLISIONS_
+namespace
+{
+	// Flips a float into an unsigned integer with the same ordering
+	// Negative floats have all bits flipped, positive floats just have the sign bit set
+	uint32_t float_to_sort_key(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+	}
+}
+
+void simulator::sort_moving_circles()
+{
+	m_SortSource = m_MovingSortKeys;
+	m_SortDestination = m_MovingSortScratch;
+
+	for (m_RadixPass = 0u; m_RadixPass < RADIX_PASSES; ++m_RadixPass)
+	{
+		run_phase(work_phase::sort_histogram);
+
+		// Turn per thread counts into scatter offsets
+		// Bucket major then thread order keeps the sort stable, which LSD radix relies on
+		uint32_t offset = 0u;
+		for (auto bucket = 0u; bucket < RADIX_BUCKETS; ++bucket)
+		{
+			for (auto t = 0u; t <= m_NumWorkers; ++t)
+			{
+				auto& count = m_RadixCounts[static_cast<size_t>(t) * RADIX_BUCKETS + bucket];
+				const auto bucketCount = count;
+				count = offset;
+				offset += bucketCount;
+			}
+		}
+
+		run_phase(work_phase::sort_scatter);
+
+		std::swap(m_SortSource, m_SortDestination);
+	}
+}
+
+void simulator::radix_histogram(collision_work* work)
+{
+	uint32_t begin, end;
+	thread_range(work->threadIndex, static_cast<uint32_t>(m_MovingCollisionData.size()), begin, end);
+
+	// First pass builds the keys from this frames positions
+	if (m_RadixPass == 0u)
+	{
+		for (auto i = begin; i < end; ++i)
+		{
+			m_SortSource[i].key = float_to_sort_key(m_MovingCollisionData.x[i]);
+			m_SortSource[i].index = i;
+		}
+	}
+
+	auto* counts = m_RadixCounts + static_cast<size_t>(work->threadIndex) * RADIX_BUCKETS;
+	std::fill(counts, counts + RADIX_BUCKETS, 0u);
+
+	const auto shift = m_RadixPass * RADIX_BITS;
+	for (auto i = begin; i < end; ++i)
+	{
+		++counts[(m_SortSource[i].key >> shift) & (RADIX_BUCKETS - 1u)];
+	}
+}
+
+void simulator::radix_scatter(collision_work* work)
+{
+	uint32_t begin, end;
+	thread_range(work->threadIndex, static_cast<uint32_t>(m_MovingCollisionData.size()), begin, end);
+
+	auto* offsets = m_RadixCounts + static_cast<size_t>(work->threadIndex) * RADIX_BUCKETS;
+
+	const auto shift = m_RadixPass * RADIX_BITS;
+	const bool finalPass = m_RadixPass == RADIX_PASSES - 1u;
+	for (auto i = begin; i < end; ++i)
+	{
+		const auto& sortKey = m_SortSource[i];
+		const auto destination = offsets[(sortKey.key >> shift) & (RADIX_BUCKETS - 1u)]++;
+		m_SortDestination[destination] = sortKey;
+
+		// Last pass knows the final order so gather the circles the sweep needs at the same time
+		if (finalPass)
+		{
+			auto& sorted = m_MovingSorted[destination];
+			sorted.position = m_MovingCollisionData.position(sortKey.index);
+			sorted.radius = m_MovingCollisionData.radius[sortKey.index];
+			sorted.index = sortKey.index;
+		}
+	}
+}
+
+void simulator::process_moving_sweep(collision_work* work)
+{
+	size_t first, number;
+	while (next_chunk(m_MovingCollisionData.size(), first, number))
+	{
+		process_moving_chunk(work, static_cast<uint32_t>(first), static_cast<uint32_t>(first + number));
+	}
+}
+
+void simulator::process_moving_chunk(collision_work* work, uint32_t begin, uint32_t end)
+{
+	const auto numMoving = m_MovingCollisionData.size();
+
+#ifdef _RANDOM_RADIUS_
+	const float maxRadius = m_Config.radiusRange.y();
+#endif
+
+	for (auto i = begin; i < end; ++i)
+	{
+		const auto& left = m_MovingSorted[i];
+
+#ifdef _RANDOM_RADIUS_
+		const float rightBound = left.position.x() + left.radius + maxRadius;
+#else
+		const float rightBound = left.position.x() + left.radius + left.radius;
+#endif
+
+		// Only sweep right. Every pair is found exactly once, by the chunk that owns its left circle
+		for (auto j = i + 1u; j < numMoving && m_MovingSorted[j].position.x() < rightBound; ++j)
+		{
+			const auto& right = m_MovingSorted[j];
+
+			#ifdef _EXPORT_THREAD_STATS_
+			work->candidatesTested++;
+			#endif
+
+			const Vector2f dxy = right.position - left.position;
+			if (collision_kernels::overlaps(dxy.x(), dxy.y(), left.radius + right.radius))
+			{
+				const auto pair = moving_circle_pair{ left.index, right.index };
+
+				// Right circle belongs to another chunk whose thread may be resolving its own pairs
+				if (j >= end)
+				{
+					work->deferredPairs.push_back(pair);
+				}
+				else
+				{
+					resolve_moving_collision(work, pair);
+				}
+			}
+		}
+	}
+}
+
+void simulator::resolve_moving_collision(collision_work* work, const moving_circle_pair& pair)
+{
+	auto& mColData = m_MovingCollisionData;
+
+	mColData.hp[pair.a] -= 20;
+	mColData.hp[pair.b] -= 20;
+
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	for (const auto index : { pair.a, pair.b })
+	{
+		if (mColData.hp[index] <= 0 && mColData.hp[index] > -20)
+		{
+			work->destroyedMoving.push_back(index);
+		}
+	}
+	#endif
+
+	// Both circles bounce off the contact normal like they would off a stationary circle
+	const Vector2f norm = (mColData.position(pair.b) - mColData.position(pair.a)).normalized();
+	const Vector2f aVelocity = mColData.velocity(pair.a);
+	const Vector2f bVelocity = mColData.velocity(pair.b);
+	mColData.set_velocity(pair.a, aVelocity - 2.0f * norm * aVelocity.dot(norm));
+	mColData.set_velocity(pair.b, bVelocity - 2.0f * norm * bVelocity.dot(norm));
+
+	#ifdef _OUTPUT_ALL_
+	collision_log_record record;
+	record.frame = m_Frame;
+	record.a = mColData.id[pair.a];
+	record.aHP = mColData.hp[pair.a];
+	record.b = mColData.id[pair.b];
+	record.bHP = mColData.hp[pair.b];
+	record.bIsMoving = true;
+	m_CollisionLog->log(work->threadIndex, record);
+	#endif
+
+	#ifdef _RECORD_COLLISION_EVENTS_
+	collision_event event;
+	event.frame = m_Frame;
+	event.movingId = mColData.id[pair.a];
+	event.otherId = mColData.id[pair.b];
+	event.kind = collision_event_kind::moving_moving;
+	event.normalX = norm.x();
+	event.normalY = norm.y();
+	event.movingHP = mColData.hp[pair.a];
+	event.otherHP = mColData.hp[pair.b];
+	m_CollisionEvents->record(work->threadIndex, event);
+	#endif
+
+	#ifdef _TRACK_COLLISIONS_
+
+	work->numberOfCollisions++;
+
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	work->phaseHits++;
+	#endif
+}
+#endif
+
+#ifdef _USE_TL_ENGINE_
+void simulator::update_tl(float deltaTime)
 {
 	#pragma region UPDATE VISUALISATION
 	// Update model positions
-	int index = 0;
-	for (auto& moving : m_MovingCollisionData)
+	for (auto index = 0u; index < m_MovingCirclesModels.size(); ++index)
 	{
-		m_MovingCirclesModels.at(index)->SetPosition(moving.position.x(), moving.position.y(), 0.0f);
-		++index;
+		m_MovingCirclesModels.at(index)->SetPosition(m_MovingCollisionData.x[index], m_MovingCollisionData.y[index], 0.0f);
 	}
 	#pragma endregion
 
@@ -550,9 +1856,9 @@ void simulator::update_tl(float deltaTime)
 	// RESET
 	if (m_TLEngine->KeyHeld(tle::Key_R))
 	{
-		currentXPos = CAMERA_DEFAULT_POSITION.x();
-		currentYPos = CAMERA_DEFAULT_POSITION.y();
-		currentZPos = CAMERA_DEFAULT_POSITION.z();
+		currentXPos = m_CameraDefaultPosition.x();
+		currentYPos = m_CameraDefaultPosition.y();
+		currentZPos = m_CameraDefaultPosition.z();
 	}
 
 	m_TLCamera->SetPosition(currentXPos, currentYPos, currentZPos);
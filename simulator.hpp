@@ -1,8 +1,24 @@
 #pragma once
 #include <array>
+#include <vector>
 
 #include "defines.hpp"
-#include "libraries/timer.h"
+#include "scene.hpp"
+#include "collision_events.hpp"
+#include "collision_kernels.hpp"
+#include "collision_log.hpp"
+#include "density_raster.hpp"
+#include "frame_publisher.hpp"
+#include "simulation_config.hpp"
+#include "slab_ranks.hpp"
+#include "snapshot.hpp"
+#include "thread_stats.hpp"
+#include "libraries/aligned_arena.hpp"
+#include "libraries/profiler.hpp"
+#include "libraries/steady_timer.hpp"
+#include "libraries/thread_pool.hpp"
+
+#include <memory>
 
 #ifdef _USE_TL_ENGINE_
 
@@ -13,7 +29,12 @@
 class simulator
 {
 public:
-	simulator(uint32_t seed = SPAWN_SEED);
+	#ifdef _MULTI_PROCESS_
+	// Simulates the slab of whichever rank this process is
+	simulator(const simulation_config& config, slab_ranks& ranks);
+	#else
+	simulator(const simulation_config& config = simulation_config());
+	#endif
 
 	~simulator();
 	
@@ -21,6 +42,15 @@ public:
 
 private:
 	#pragma region CIRCLE DATA
+	// Scene size, ranges and thread count this run was started with
+	simulation_config			m_Config;
+
+	// Every array sized by the config comes from here. Freed when the simulator is destroyed
+	aligned_arena				m_Arena{ CACHE_LINE_SIZE, aligned_arena::DEFAULT_BLOCK_SIZE, m_Config.hugePages };
+
+	// Snapshot the run resumed from. The collision arrays and stationary HP point into it rather than the arena
+	std::unique_ptr<mapped_file>	m_Snapshot;
+
 	// Arrays are synchronized. Index 2 in unique + collision array is same circle
 	// Typedefs in defines.hpp because they get really LONG
 
@@ -28,37 +58,246 @@ private:
 	stationary_collision_array	m_StationaryCollisionData = stationary_collision_array();
 	// Other data for stationary circles when outputting
 	stationary_unique_array		m_StationaryUniqueData = stationary_unique_array();
-	// Array to protect HP of stationary circles
-	stationary_mutex_array		m_StationaryMutexes;
+	// HP of stationary circles. Any thread can hit any stationary circle so damage is an atomic subtract rather than a lock
+	std::atomic<int32_t>*		m_StationaryHP = nullptr;
 	
 	// Array of data to process moving circles in collision
 	moving_collision_array		m_MovingCollisionData = moving_collision_array();
 	// Other data for moving circles when outputting
 	moving_unique_array			m_MovingUniqueData = moving_unique_array();
 
+	#ifdef _QUANTIZED_POSITIONS_
+	// Maps the spawn range onto 16 bit fixed point
+	collision_kernels::position_quantizer	m_Quantizer;
+	// Stationary positions packed by m_Quantizer, in the same order as m_StationaryCollisionData
+	uint32_t*					m_StationaryPacked = nullptr;
+	#endif
+
+	#ifdef _EYTZINGER_SEARCH_
+	// Search tree over the stationary x array. Finds where the line sweeps start
+	collision_kernels::sweep_search_index	m_StationarySearch;
+	#endif
+
+	#ifdef _USE_SPATIAL_GRID_
+	// A cell is as wide as the furthest two circles can be apart and still touch
+	// This means any possible collision is within the 3x3 cells around a moving circle
+	float						m_GridCellSize = 0.0f;
+	// Grid covers the spawn range as stationary circles never leave it
+	uint32_t					m_GridCellsX = 0u;
+	uint32_t					m_GridCellsY = 0u;
+	// Start offset of each grid cell into m_StationaryGridIndices. Has one extra entry so the last cell has an end
+	uint32_t*					m_StationaryGridCellStarts = nullptr;
+	// Indexes into m_StationaryCollisionData grouped by cell
+	uint32_t*					m_StationaryGridIndices = nullptr;
+	#endif
+
+	#ifdef _MOVING_COLLISIONS_
+	// Radix sort ping-pongs between these two key arrays
+	moving_sort_key*			m_MovingSortKeys = nullptr;
+	moving_sort_key*			m_MovingSortScratch = nullptr;
+	moving_sort_key*			m_SortSource = nullptr;
+	moving_sort_key*			m_SortDestination = nullptr;
+	// Bucket counts for each thread, turned into scatter offsets between the two phases of a pass
+	uint32_t*					m_RadixCounts = nullptr;
+	// Which pass of the radix sort is running
+	uint32_t					m_RadixPass = 0u;
+	// Moving circles gathered in x order by the final pass
+	moving_sorted_circle*		m_MovingSorted = nullptr;
+	#endif
+
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	// Survivors to copy into the slots of destroyed moving circles, shared out between threads by fill_destroyed_moving
+	std::vector<moving_circle_move>	m_MovingMoves;
+	#endif
+
+	#ifdef _MULTI_PROCESS_
+	// Which slab this process has, and the memory shared with the other ranks
+	slab_ranks*					m_Ranks = nullptr;
+	// Sorted index in the whole scene of the first stationary circle this rank has
+	size_t						m_FirstStationary = 0u;
+	// Moving circles leaving the slab this frame and those that arrived. Kept to reuse their memory
+	std::vector<migrating_circle>	m_LeavingLeft;
+	std::vector<migrating_circle>	m_LeavingRight;
+	std::vector<migrating_circle>	m_Arrived;
+	#endif
+
 	#pragma endregion
 
 	#pragma region THREAD POOL
-	// Maximum possible thread pool size
-	static const uint32_t MAX_WORKERS = 31u;
-
-	// Array of up to max workers
-	std::array<paired_worker, MAX_WORKERS> m_CollisionWorkers;
+	// Work for each worker plus the main thread, which is always the last
+	std::vector<collision_work> m_CollisionWork;
 
 	// Actual amount of threads in use
 	uint32_t m_NumWorkers = 0u;
+
+	// Runs each phase on the workers and main thread
+	std::unique_ptr<thread_pool> m_ThreadPool;
+
+	// Start of the next chunk of circles to hand out in the current phase
+	std::atomic<uint32_t> m_NextChunk = { 0u };
+
+	// One slice of the moving circles per thread, for the first_touch option. Each on its own cache line as any thread can take from any slice
+	struct alignas(CACHE_LINE_SIZE) chunk_slice
+	{
+		std::atomic<uint32_t>	next = { 0u };
+		uint32_t				end = 0u;
+	};
+	std::vector<chunk_slice> m_ChunkSlices;
+
+	// Frames simulated so far
+	uint32_t m_Frame = 0u;
+
+	#ifdef _OUTPUT_ALL_
+	// Every thread logs its collisions here
+	std::unique_ptr<collision_log> m_CollisionLog;
+	#endif
+
+	#ifdef _RECORD_COLLISION_EVENTS_
+	// Every thread records its collisions here
+	std::unique_ptr<collision_event_writer> m_CollisionEvents;
+	#endif
+
+	#ifdef _RASTERISE_FRAMES_
+	// Heatmap of the circles, drawn every raster_every frames
+	std::unique_ptr<density_raster> m_DensityRaster;
+	#ifdef _PUBLISH_FRAME_STATE_
+	// Drawing happens on the consumer thread, which shares it with the raster_threads - 1 workers of this pool
+	std::unique_ptr<thread_pool> m_RasterPool;
+	// First frame the consumer should draw. It can skip frames so draws the first one it sees at or after this
+	uint32_t m_NextRasterFrame = 0u;
+	#endif
+	#endif
+
+	#ifdef _PUBLISH_FRAME_STATE_
+	// Copy of the circles for consumers at the end of every frame. After anything its consumers use, so it stops them first
+	std::unique_ptr<frame_publisher> m_FramePublisher;
+	// Changes whenever the stationary arrays do, so the publisher knows to copy them again
+	uint64_t m_StationaryVersion = 1u;
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	// Gets a record per thread for every phase
+	std::unique_ptr<thread_stats_writer> m_ThreadStats;
+	// Record times are relative to this
+	thread_pool::clock::time_point m_ThreadStatsStart;
+	#endif
+
+	#ifdef _PROFILE_ZONES_
+	// Zone of the phase being run, which each threads share goes under
+	profiler::zone_id m_PhaseZone = profiler::ROOT_ZONE;
+	#endif
 	#pragma endregion
 
 	#pragma region FUNCTIONS
 	// Outputs the program state to the console
 	void output_beginning_message();
-	void check_collision(uint32_t threadIndex);
+	// False in every process but the first when running as ranks, so everything is only printed once
+	bool is_reporting() const;
+	// Bytes used by all the circle data
+	size_t circle_data_size() const;
+	// Writes a snapshot if this frame is due one
+	void write_checkpoint();
+	#ifdef _RASTERISE_FRAMES_
+	// Draws and writes the heatmap if the frame that is finishing is due one
+	void rasterise_frame();
+	#ifdef _PUBLISH_FRAME_STATE_
+	// As above from a published copy, on the consumer thread
+	void rasterise_state(const frame_state& state);
+	#endif
+	// Writes the image just drawn and says how long it took
+	void write_raster(uint32_t frame, std::chrono::steady_clock::time_point start);
+	#endif
+	// Moves the current chunk of moving circles by their velocity
+	void integrate_positions(collision_work* work);
+	// Wakes every worker on the given phase, does the main threads share then waits for them all
+	void run_phase(work_phase phase);
+	// Runs whatever phase the work is set to
+	void process_phase(collision_work* work);
+	// Splits count items evenly between every thread including the main thread
+	void thread_range(uint32_t threadIndex, uint32_t count, uint32_t& begin, uint32_t& end) const;
+	// Takes the next chunk of count items. False once they have all been handed out
+	bool next_chunk(size_t count, size_t& first, size_t& number);
+	// Splits count moving circles into a slice per thread the same way the scene was generated
+	void reset_chunk_slices(uint32_t count);
+	// Takes the next chunk of the threads own slice, or another slice once that's done. False once they have all been handed out
+	bool next_slice_chunk(uint32_t threadIndex, size_t& first, size_t& number);
+	// Pins every thread in the pool, main included, to its own CPU. Throws std::runtime_error if any can't be
+	void pin_threads();
+	// Work of a worker, or the main thread for the last index
+	collision_work& work_for_thread(uint32_t threadIndex);
+
+	#ifdef _TIME_THREADS_
+	// Outputs how long each thread was busy this frame
+	void output_thread_times();
+	#endif
+
+	#ifdef _EXPORT_THREAD_STATS_
+	// Hands every threads timings and counters for the phase that just ran to the stats writer
+	void record_phase_stats(work_phase phase);
+	#endif
 	// As above but with a line sweep algorithm
 	void process_collision_sweep(collision_work* work);
+	#ifdef _SWEPT_COLLISIONS_
+	// Alternative to integrating then process_collision_sweep. Moves each circle along its motion for the frame,
+	// stopping and bouncing at the first stationary circle in the way rather than only testing where it ends up
+	void process_collision_swept(collision_work* work);
+	#endif
+	// Finds a stationary circle strictly between the bounds for the line sweeps to start from
+	bool find_stationary_sweep_start(const stationary_collision_array& sColData, float leftBound, float rightBound, size_t& circleFound) const;
+	// Applies the damage and reflection of a moving circle hitting a stationary circle
+	void resolve_collision(collision_work* work, size_t movingIndex, size_t stationaryIndex, const Vector2f& dxy);
+
+	#ifdef _QUANTIZED_POSITIONS_
+	// Packs the stationary positions for process_collision_sweep
+	void quantize_stationary_positions();
+	#endif
+
+	#ifdef _EYTZINGER_SEARCH_
+	// Lays out the search tree over the sorted stationary x array
+	void build_stationary_search();
+	#endif
+
+	#ifdef _REMOVE_DESTROYED_CIRCLES_
+	// Takes out every circle the threads found destroyed this frame. Runs with the workers parked
+	void remove_destroyed_circles();
+	// Finds circles that were already destroyed when the simulation was set up, then removes them
+	void remove_already_destroyed();
+	// Shifts stationary circles down over destroyed ones so x stays sorted. destroyed is sorted
+	void remove_destroyed_stationary(const std::vector<uint32_t>& destroyed);
+	// Fills the slots of destroyed moving circles with survivors from the end of the array. destroyed is sorted
+	void remove_destroyed_moving(const std::vector<uint32_t>& destroyed);
+	void fill_destroyed_moving(collision_work* work);
+	#endif
+
+	#ifdef _USE_SPATIAL_GRID_
+	// Buckets the sorted stationary circles into the grid
+	void build_stationary_grid();
+	// Alternative to process_collision_sweep that only tests the 3x3 grid cells around each moving circle
+	void process_collision_grid(collision_work* work);
+	#endif
+
+	#ifdef _MULTI_PROCESS_
+	// Swaps moving circles that crossed the slab edges with the neighbouring ranks. Returns how many left
+	uint32_t migrate_moving_circles();
+	// Hands this ranks frame to the others, then rank 0 outputs the frame for all of them
+	void output_rank_frame(const rank_frame_stats& stats, float timeToProcess);
+	#endif
+
+	#ifdef _MOVING_COLLISIONS_
+	// Parallel LSD radix sort of the moving circles by x. Leaves the result in m_MovingSorted
+	void sort_moving_circles();
+	void radix_histogram(collision_work* work);
+	void radix_scatter(collision_work* work);
+	// Line sweeps the sorted moving circles for pairs a chunk at a time. Pair is owned by the chunk that has its left circle
+	void process_moving_sweep(collision_work* work);
+	void process_moving_chunk(collision_work* work, uint32_t begin, uint32_t end);
+	// Applies damage and reflection to both moving circles in a pair
+	void resolve_moving_collision(collision_work* work, const moving_circle_pair& pair);
+	#endif
 	
 	#pragma endregion
 
-	msc::platform::Timer m_Timer;
+	steady_timer m_Timer;
 	
 	#ifdef _USE_TL_ENGINE_
 
@@ -71,8 +310,11 @@ private:
 	tle::IMesh* m_MovingMesh;
 
 	// Array to store model instnaces
-	std::array<tle::IModel*, NUM_STATIONARY_CIRCLES> m_StationaryCircleModels;
-	std::array<tle::IModel*, NUM_MOVING_CIRCLES> m_MovingCirclesModels;
+	std::vector<tle::IModel*> m_StationaryCircleModels;
+	std::vector<tle::IModel*> m_MovingCirclesModels;
+
+	// Far enough back to see the whole spawn range
+	Vector3f m_CameraDefaultPosition = Vector3f(0.0f, 0.0f, 0.0f);
 
 	// Pause visualsation
 	bool m_IsPaused = false;
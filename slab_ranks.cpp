@@ -0,0 +1,301 @@
+#include "slab_ranks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Times a rank checks the barrier before it starts sleeping between checks
+	// Ranks usually arrive close together, but one can be waiting most of a frame for a slower slab
+	constexpr uint32_t BARRIER_SPIN_COUNT = 20000u;
+
+	// Outbox directions
+	constexpr uint32_t TO_LEFT = 0u;
+	constexpr uint32_t TO_RIGHT = 1u;
+
+	size_t round_to_cache_line(size_t bytes)
+	{
+		return (bytes + CACHE_LINE_SIZE - 1u) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+	}
+}
+
+struct alignas(CACHE_LINE_SIZE) slab_ranks::shared_header
+{
+	std::atomic<uint32_t>	barrierArrived = { 0u };
+	std::atomic<uint32_t>	barrierGeneration = { 0u };
+	// 0 while every rank is running, otherwise 1 + the rank that stopped first
+	std::atomic<uint32_t>	stopped = { 0u };
+};
+
+// Only written by its own rank, and only read by the others after a barrier
+struct alignas(CACHE_LINE_SIZE) slab_ranks::rank_state
+{
+	// By frame parity. The next frame can be handed in while rank 0 is still reporting this one
+	rank_frame_stats	frames[2];
+	// Circles in each outbox this round
+	uint32_t			outboxCount[2] = { 0u, 0u };
+	// Circles still waiting to go after this round
+	uint32_t			pending = 0u;
+};
+
+slab_ranks::slab_ranks(const simulation_config& config) : m_RankConfig(config), m_NumRanks(config.ranks)
+{
+#ifdef _WIN32
+	throw std::runtime_error("_MULTI_PROCESS_ forks a process per rank so needs a POSIX system");
+#else
+	if (!config.resumeFile.empty() || config.checkpointEvery != 0u)
+	{
+		throw std::runtime_error("Snapshots can't be used with _MULTI_PROCESS_ as no rank has the whole scene");
+	}
+
+	// Share the threads out rather than every rank starting one per hardware thread
+	const auto totalThreads = config.threads != 0u ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+	m_RankConfig.threads = std::max(1u, totalThreads / m_NumRanks);
+
+	m_StatesOffset = round_to_cache_line(sizeof(shared_header));
+	m_OutboxesOffset = m_StatesOffset + sizeof(rank_state) * m_NumRanks;
+	m_HPOffset = round_to_cache_line(m_OutboxesOffset + sizeof(migrating_circle) * MIGRATION_BATCH_SIZE * 2u * m_NumRanks);
+	m_Shared = std::make_unique<shared_memory>(m_HPOffset + sizeof(std::atomic<int32_t>) * config.numStationaryCircles);
+
+	// Made before there are any other processes to see them
+	new (&header()) shared_header();
+	for (auto rank = 0u; rank < m_NumRanks; ++rank)
+	{
+		new (&state(rank)) rank_state();
+	}
+	auto* hp = stationary_hp();
+	for (auto i = 0u; i < config.numStationaryCircles; ++i)
+	{
+		new (&hp[i]) std::atomic<int32_t>(100);
+	}
+
+	// Anything still buffered would be written once by every process
+	std::cout.flush();
+	std::cerr.flush();
+	std::fflush(nullptr);
+
+	m_Parent = static_cast<int>(getpid());
+	for (auto rank = 1u; rank < m_NumRanks; ++rank)
+	{
+		const auto child = fork();
+		if (child < 0)
+		{
+			// Ranks already started see this and stop
+			header().stopped.store(1u, std::memory_order_release);
+			throw std::runtime_error("Could not start rank " + std::to_string(rank));
+		}
+		if (child == 0)
+		{
+			m_Rank = rank;
+			m_Children.clear();
+			return;
+		}
+		m_Children.push_back(static_cast<int>(child));
+	}
+#endif
+}
+
+slab_ranks::~slab_ranks()
+{
+	// Any rank leaving means the run is over
+	uint32_t running = 0u;
+	header().stopped.compare_exchange_strong(running, m_Rank + 1u, std::memory_order_acq_rel);
+
+#ifndef _WIN32
+	for (const auto child : m_Children)
+	{
+		waitpid(child, nullptr, 0);
+	}
+#endif
+}
+
+float slab_ranks::slab_left(uint32_t rank) const
+{
+	if (rank == 0u)
+	{
+		return -INFINITY;
+	}
+
+	// Equal widths of the spawn range. Circles are spread evenly across it so each slab starts with a similar share
+	const auto& range = m_RankConfig.xSpawnRange;
+	return range.x() + (range.y() - range.x()) * static_cast<float>(rank) / static_cast<float>(m_NumRanks);
+}
+
+float slab_ranks::slab_right(uint32_t rank) const
+{
+	return rank + 1u == m_NumRanks ? INFINITY : slab_left(rank + 1u);
+}
+
+std::atomic<int32_t>* slab_ranks::stationary_hp()
+{
+	return reinterpret_cast<std::atomic<int32_t>*>(m_Shared->data() + m_HPOffset);
+}
+
+void slab_ranks::barrier()
+{
+	auto& shared = header();
+
+	// Can't change until this rank has arrived too
+	const auto generation = shared.barrierGeneration.load(std::memory_order_acquire);
+	if (shared.barrierArrived.fetch_add(1u, std::memory_order_acq_rel) + 1u == m_NumRanks)
+	{
+		// Last in. Reset for next time before letting everyone go
+		shared.barrierArrived.store(0u, std::memory_order_relaxed);
+		shared.barrierGeneration.fetch_add(1u, std::memory_order_release);
+		return;
+	}
+
+	for (uint32_t spins = 0u; shared.barrierGeneration.load(std::memory_order_acquire) == generation; ++spins)
+	{
+		if (spins >= BARRIER_SPIN_COUNT)
+		{
+			check_ranks_running();
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+}
+
+void slab_ranks::exchange(std::vector<migrating_circle>& toLeft, std::vector<migrating_circle>& toRight, std::vector<migrating_circle>& arrived)
+{
+	arrived.clear();
+
+	std::vector<migrating_circle>* outgoing[2] = { &toLeft, &toRight };
+	size_t sent[2] = { 0u, 0u };
+	const float left = slab_left(m_Rank);
+	const float right = slab_right(m_Rank);
+	auto& mine = state(m_Rank);
+
+	// Rounds until nothing is waiting anywhere. Usually just one
+	while (true)
+	{
+		for (auto direction = 0u; direction < 2u; ++direction)
+		{
+			const auto& circles = *outgoing[direction];
+			const auto count = std::min<size_t>(circles.size() - sent[direction], MIGRATION_BATCH_SIZE);
+			std::copy(circles.begin() + static_cast<std::ptrdiff_t>(sent[direction]), circles.begin() + static_cast<std::ptrdiff_t>(sent[direction] + count),
+				outbox(m_Rank, direction));
+			mine.outboxCount[direction] = static_cast<uint32_t>(count);
+			sent[direction] += count;
+		}
+
+		barrier();
+
+		// Circles moving right are in the left neighbours right outbox and the other way round
+		const auto receive = [&](uint32_t from, uint32_t direction)
+		{
+			const auto* box = outbox(from, direction);
+			for (auto i = 0u; i < state(from).outboxCount[direction]; ++i)
+			{
+				const auto& circle = box[i];
+				if (circle.x < left)
+				{
+					toLeft.push_back(circle);
+				}
+				else if (circle.x >= right)
+				{
+					toRight.push_back(circle);
+				}
+				else
+				{
+					arrived.push_back(circle);
+				}
+			}
+		};
+		if (m_Rank > 0u)
+		{
+			receive(m_Rank - 1u, TO_RIGHT);
+		}
+		if (m_Rank + 1u < m_NumRanks)
+		{
+			receive(m_Rank + 1u, TO_LEFT);
+		}
+		mine.pending = static_cast<uint32_t>(toLeft.size() - sent[TO_LEFT] + toRight.size() - sent[TO_RIGHT]);
+
+		barrier();
+
+		bool anyPending = false;
+		for (auto rank = 0u; rank < m_NumRanks; ++rank)
+		{
+			anyPending |= state(rank).pending != 0u;
+		}
+		if (!anyPending)
+		{
+			break;
+		}
+	}
+
+	toLeft.clear();
+	toRight.clear();
+}
+
+void slab_ranks::end_frame(uint32_t frame, const rank_frame_stats& stats)
+{
+	state(m_Rank).frames[frame & 1u] = stats;
+	barrier();
+}
+
+const rank_frame_stats& slab_ranks::frame_stats(uint32_t rank, uint32_t frame) const
+{
+	return state(rank).frames[frame & 1u];
+}
+
+slab_ranks::shared_header& slab_ranks::header()
+{
+	return *reinterpret_cast<shared_header*>(m_Shared->data());
+}
+
+slab_ranks::rank_state& slab_ranks::state(uint32_t rank)
+{
+	return reinterpret_cast<rank_state*>(m_Shared->data() + m_StatesOffset)[rank];
+}
+
+const slab_ranks::rank_state& slab_ranks::state(uint32_t rank) const
+{
+	return reinterpret_cast<const rank_state*>(m_Shared->data() + m_StatesOffset)[rank];
+}
+
+migrating_circle* slab_ranks::outbox(uint32_t rank, uint32_t direction)
+{
+	return reinterpret_cast<migrating_circle*>(m_Shared->data() + m_OutboxesOffset) + (static_cast<size_t>(rank) * 2u + direction) * MIGRATION_BATCH_SIZE;
+}
+
+void slab_ranks::check_ranks_running()
+{
+	const auto stopped = header().stopped.load(std::memory_order_acquire);
+	if (stopped != 0u)
+	{
+		throw std::runtime_error("Rank " + std::to_string(stopped - 1u) + " stopped");
+	}
+
+#ifndef _WIN32
+	// A rank killed outright never gets to say so
+	if (m_Rank == 0u)
+	{
+		for (size_t child = 0; child < m_Children.size(); ++child)
+		{
+			if (waitpid(m_Children[child], nullptr, WNOHANG) == m_Children[child])
+			{
+				header().stopped.store(static_cast<uint32_t>(child) + 2u, std::memory_order_release);
+				m_Children.erase(m_Children.begin() + static_cast<std::ptrdiff_t>(child));
+				throw std::runtime_error("Rank " + std::to_string(child + 1u) + " stopped");
+			}
+		}
+	}
+	else if (static_cast<int>(getppid()) != m_Parent)
+	{
+		throw std::runtime_error("Rank 0 stopped");
+	}
+#endif
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "defines.hpp"
+#include "simulation_config.hpp"
+#include "libraries/shared_memory.hpp"
+
+// A moving circle on its way to another rank
+struct migrating_circle
+{
+	float			x = 0.0f;
+	float			y = 0.0f;
+	float			velocityX = 0.0f;
+	float			velocityY = 0.0f;
+	float			radius = 1.0f;
+	int32_t			hp = 100;
+	uint32_t		id = 0u;
+	circle_color	color;
+};
+
+// What a rank did in a frame. The first rank reports every ranks once they have all handed theirs in
+struct rank_frame_stats
+{
+	uint32_t	collisions = 0u;
+	uint32_t	movingCircles = 0u;
+	uint32_t	migrated = 0u;
+	// Seconds colliding, then handing circles to and from the neighbours
+	float		collideTime = 0.0f;
+	float		exchangeTime = 0.0f;
+};
+
+// Splits the spawn area into one x-slab per process for _MULTI_PROCESS_
+// Made first thing in main. Sets up the shared memory then forks, so each rank returns from the constructor in its own process
+// Rank 0 is the process that was started. It waits for the others when it is destroyed
+//
+// Everything shared lives in one block: a barrier, each ranks stats and mailboxes, then the HP of every stationary circle
+// Ranks only ever hand circles to the next rank along, a circle crossing more than one slab is passed on again
+class slab_ranks
+{
+public:
+	// Throws std::runtime_error if the config can't be split, or the memory or processes can't be made
+	explicit slab_ranks(const simulation_config& config);
+
+	// Tells the other ranks to stop. Rank 0 then waits for them to exit
+	~slab_ranks();
+
+	slab_ranks(const slab_ranks&) = delete;
+	slab_ranks& operator=(const slab_ranks&) = delete;
+
+	uint32_t rank() const { return m_Rank; }
+	uint32_t num_ranks() const { return m_NumRanks; }
+
+	// Config for the simulator in this process. Threads are shared out between the ranks
+	const simulation_config& rank_config() const { return m_RankConfig; }
+
+	// Moving circles with left <= x < right belong to a rank. The end slabs carry on forever
+	float slab_left(uint32_t rank) const;
+	float slab_right(uint32_t rank) const;
+
+	// Every stationary circle in sorted order, each rank indexes it with the sorted index of its circles
+	std::atomic<int32_t>* stationary_hp();
+
+	// Waits until every rank gets here. Throws std::runtime_error if one of them has stopped
+	void barrier();
+
+	// Sends the circles to the neighbouring ranks and collects any sent here. Every rank has to call it
+	// Circles that arrive but carry on past this slab are sent on, so arrived only has circles for this rank
+	void exchange(std::vector<migrating_circle>& toLeft, std::vector<migrating_circle>& toRight, std::vector<migrating_circle>& arrived);
+
+	// Hands in this ranks stats then waits for every rank to do the same, so frame_stats can be read for any of them
+	void end_frame(uint32_t frame, const rank_frame_stats& stats);
+	const rank_frame_stats& frame_stats(uint32_t rank, uint32_t frame) const;
+
+private:
+	struct shared_header;
+	struct rank_state;
+
+	shared_header& header();
+	rank_state& state(uint32_t rank);
+	const rank_state& state(uint32_t rank) const;
+	migrating_circle* outbox(uint32_t rank, uint32_t direction);
+
+	// Throws if another rank has stopped
+	void check_ranks_running();
+
+	simulation_config	m_RankConfig;
+	uint32_t			m_Rank = 0u;
+	uint32_t			m_NumRanks = 1u;
+
+	std::unique_ptr<shared_memory>	m_Shared;
+	// Offsets into the shared block
+	size_t				m_StatesOffset = 0u;
+	size_t				m_OutboxesOffset = 0u;
+	size_t				m_HPOffset = 0u;
+
+	// Process ids. The children of rank 0, or rank 0 itself for the others
+	std::vector<int>	m_Children;
+	int					m_Parent = 0;
+};
@@ -0,0 +1,211 @@
+#include "snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+namespace
+{
+	constexpr size_t SECTION_ALIGNMENT = 64u;
+
+	uint32_t build_flags()
+	{
+		uint32_t flags = 0u;
+#ifdef _RANDOM_RADIUS_
+		flags |= SNAPSHOT_FLAG_RANDOM_RADIUS;
+#endif
+		return flags;
+	}
+
+	// Writes sections one after another, padding each to the section alignment and noting where it went
+	class section_writer
+	{
+	public:
+		section_writer(std::ofstream& file, snapshot_header& header) : m_File(file), m_Header(header), m_Offset(sizeof(snapshot_header))
+		{
+		}
+
+		void write(snapshot_section_id id, const void* data, size_t bytes)
+		{
+			static const char padding[SECTION_ALIGNMENT] = {};
+			const auto padded = (m_Offset + SECTION_ALIGNMENT - 1u) & ~(SECTION_ALIGNMENT - 1u);
+			m_File.write(padding, static_cast<std::streamsize>(padded - m_Offset));
+
+			auto& section = m_Header.sections[static_cast<size_t>(id)];
+			section.offset = padded;
+			section.bytes = bytes;
+
+			m_File.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+			m_Offset = padded + bytes;
+		}
+
+	private:
+		std::ofstream&		m_File;
+		snapshot_header&	m_Header;
+		size_t				m_Offset;
+	};
+
+	void set_range(float* out, const Vector2f& range)
+	{
+		out[0] = range.x();
+		out[1] = range.y();
+	}
+}
+
+void write_snapshot(const std::string& path, uint32_t frame, const simulation_config& config,
+	const stationary_collision_array& sColData, const stationary_unique_array& sUniqueArray, const std::atomic<int32_t>* sHP,
+	const moving_collision_array& mColData, const moving_unique_array& mUniqueArray)
+{
+	const auto numStationary = sUniqueArray.size();
+	const auto numRemaining = sColData.size();
+	const auto numMoving = mColData.size();
+
+	snapshot_header header;
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.headerSize = sizeof(snapshot_header);
+	header.frame = frame;
+	header.flags = build_flags();
+	header.numStationaryCircles = static_cast<uint32_t>(numStationary);
+	header.numMovingCircles = static_cast<uint32_t>(numMoving);
+	header.seed = config.seed;
+	header.numStationaryRemaining = static_cast<uint32_t>(numRemaining);
+	set_range(header.xSpawnRange, config.xSpawnRange);
+	set_range(header.ySpawnRange, config.ySpawnRange);
+	set_range(header.xVelocityRange, config.xVelocityRange);
+	set_range(header.yVelocityRange, config.yVelocityRange);
+	set_range(header.radiusRange, config.radiusRange);
+
+	const auto tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			throw std::runtime_error("Could not open snapshot " + tempPath);
+		}
+
+		// Header goes first as a placeholder, then again once the section offsets are known
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		section_writer sections(file, header);
+		sections.write(snapshot_section_id::stationary_x, sColData.x, numRemaining * sizeof(float));
+		sections.write(snapshot_section_id::stationary_y, sColData.y, numRemaining * sizeof(float));
+		sections.write(snapshot_section_id::stationary_radius, sColData.radius, numRemaining * sizeof(float));
+		sections.write(snapshot_section_id::stationary_unique_index, sColData.uniqueIndex, numRemaining * sizeof(uint32_t));
+		sections.write(snapshot_section_id::stationary_hp, sHP, numStationary * sizeof(int32_t));
+		sections.write(snapshot_section_id::stationary_color, sUniqueArray.color, numStationary * sizeof(circle_color));
+		sections.write(snapshot_section_id::moving_x, mColData.x, numMoving * sizeof(float));
+		sections.write(snapshot_section_id::moving_y, mColData.y, numMoving * sizeof(float));
+		sections.write(snapshot_section_id::moving_velocity_x, mColData.velocityX, numMoving * sizeof(float));
+		sections.write(snapshot_section_id::moving_velocity_y, mColData.velocityY, numMoving * sizeof(float));
+		sections.write(snapshot_section_id::moving_radius, mColData.radius, numMoving * sizeof(float));
+		sections.write(snapshot_section_id::moving_hp, mColData.hp, numMoving * sizeof(int32_t));
+		sections.write(snapshot_section_id::moving_color, mUniqueArray.color, numMoving * sizeof(circle_color));
+		sections.write(snapshot_section_id::moving_id, mColData.id, numMoving * sizeof(uint32_t));
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!file.flush())
+		{
+			throw std::runtime_error("Could not write snapshot " + tempPath);
+		}
+	}
+
+	// Replaces the old snapshot in one step, so a crash leaves either the old or the new one
+	// Windows' rename won't replace an existing file, MoveFileEx will
+#ifdef _WIN32
+	if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+#endif
+	{
+		throw std::runtime_error("Could not replace snapshot " + path);
+	}
+}
+
+std::unique_ptr<mapped_file> load_snapshot(const std::string& path, simulation_config& config, uint32_t& frame,
+	stationary_collision_array& sColData, stationary_unique_array& sUniqueArray, std::atomic<int32_t>*& sHP,
+	moving_collision_array& mColData, moving_unique_array& mUniqueArray)
+{
+	// Copy on write as the simulation writes to the arrays, but must never change the snapshot
+	auto file = std::make_unique<mapped_file>(path, mapped_file::access::copy_on_write);
+
+	if (file->size() < sizeof(snapshot_header))
+	{
+		throw std::runtime_error(path + " is too small to be a snapshot");
+	}
+	const auto& header = *reinterpret_cast<const snapshot_header*>(file->data());
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+	{
+		throw std::runtime_error(path + " is not a snapshot");
+	}
+	if (header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(snapshot_header))
+	{
+		throw std::runtime_error(path + " is snapshot version " + std::to_string(header.version) + " but this build reads version " + std::to_string(SNAPSHOT_VERSION));
+	}
+	if (header.flags != build_flags())
+	{
+		throw std::runtime_error(path + " was written by a build with different options (_RANDOM_RADIUS_)");
+	}
+
+	config.numStationaryCircles = header.numStationaryCircles;
+	config.numMovingCircles = header.numMovingCircles;
+	config.seed = header.seed;
+	config.xSpawnRange = Vector2f(header.xSpawnRange[0], header.xSpawnRange[1]);
+	config.ySpawnRange = Vector2f(header.ySpawnRange[0], header.ySpawnRange[1]);
+	config.xVelocityRange = Vector2f(header.xVelocityRange[0], header.xVelocityRange[1]);
+	config.yVelocityRange = Vector2f(header.yVelocityRange[0], header.yVelocityRange[1]);
+	config.radiusRange = Vector2f(header.radiusRange[0], header.radiusRange[1]);
+	config.validate();
+	frame = header.frame;
+
+	if (header.numStationaryRemaining > header.numStationaryCircles)
+	{
+		throw std::runtime_error(path + " is damaged, it has more stationary circles remaining than it started with");
+	}
+
+	const size_t numStationary = header.numStationaryCircles;
+	const size_t numRemaining = header.numStationaryRemaining;
+	const size_t numMoving = header.numMovingCircles;
+	const auto fileSize = file->size();
+	auto* const base = file->data();
+
+	const auto section = [&](snapshot_section_id id, size_t bytes)
+	{
+		const auto& entry = header.sections[static_cast<size_t>(id)];
+		if (entry.bytes != bytes || entry.offset % SECTION_ALIGNMENT != 0u || entry.offset > fileSize || fileSize - entry.offset < bytes)
+		{
+			throw std::runtime_error(path + " is damaged, section " + std::to_string(static_cast<uint32_t>(id)) + " is out of place");
+		}
+		return base + entry.offset;
+	};
+
+	sColData.x = reinterpret_cast<float*>(section(snapshot_section_id::stationary_x, numRemaining * sizeof(float)));
+	sColData.y = reinterpret_cast<float*>(section(snapshot_section_id::stationary_y, numRemaining * sizeof(float)));
+	sColData.radius = reinterpret_cast<float*>(section(snapshot_section_id::stationary_radius, numRemaining * sizeof(float)));
+	sColData.uniqueIndex = reinterpret_cast<uint32_t*>(section(snapshot_section_id::stationary_unique_index, numRemaining * sizeof(uint32_t)));
+	sColData.count = numRemaining;
+	sHP = reinterpret_cast<std::atomic<int32_t>*>(section(snapshot_section_id::stationary_hp, numStationary * sizeof(int32_t)));
+
+	mColData.x = reinterpret_cast<float*>(section(snapshot_section_id::moving_x, numMoving * sizeof(float)));
+	mColData.y = reinterpret_cast<float*>(section(snapshot_section_id::moving_y, numMoving * sizeof(float)));
+	mColData.velocityX = reinterpret_cast<float*>(section(snapshot_section_id::moving_velocity_x, numMoving * sizeof(float)));
+	mColData.velocityY = reinterpret_cast<float*>(section(snapshot_section_id::moving_velocity_y, numMoving * sizeof(float)));
+	mColData.radius = reinterpret_cast<float*>(section(snapshot_section_id::moving_radius, numMoving * sizeof(float)));
+	mColData.hp = reinterpret_cast<int32_t*>(section(snapshot_section_id::moving_hp, numMoving * sizeof(int32_t)));
+	mColData.id = reinterpret_cast<uint32_t*>(section(snapshot_section_id::moving_id, numMoving * sizeof(uint32_t)));
+	mColData.count = numMoving;
+
+	sUniqueArray.color = reinterpret_cast<circle_color*>(section(snapshot_section_id::stationary_color, numStationary * sizeof(circle_color)));
+	sUniqueArray.count = numStationary;
+	mUniqueArray.color = reinterpret_cast<circle_color*>(section(snapshot_section_id::moving_color, numMoving * sizeof(circle_color)));
+	mUniqueArray.count = numMoving;
+
+	return file;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "defines.hpp"
+#include "simulation_config.hpp"
+#include "libraries/mapped_file.hpp"
+
+#pragma region FILE FORMAT
+// Snapshot of everything that changes while the simulation runs, so a run can be resumed or forked from any frame
+//
+// [snapshot_header] then one array per section, each starting on a 64 byte boundary
+// The arrays are exactly what the simulator works on so a mapped snapshot is used in place, nothing is parsed
+// Little endian. Names are never stored, see stationary_circle_name and moving_circle_name
+
+constexpr char		SNAPSHOT_MAGIC[8] = { 'M', 'T', 'V', 'S', 'N', 'A', 'P', '\0' };
+constexpr uint32_t	SNAPSHOT_VERSION = 3u;
+
+// Build options that change what the arrays mean. A snapshot only loads into a build with the same ones
+constexpr uint32_t	SNAPSHOT_FLAG_RANDOM_RADIUS = 1u << 0;
+
+enum class snapshot_section_id : uint32_t
+{
+	stationary_x,
+	stationary_y,
+	stationary_radius,
+	stationary_unique_index,
+	stationary_hp,
+	stationary_color,
+	moving_x,
+	moving_y,
+	moving_velocity_x,
+	moving_velocity_y,
+	moving_radius,
+	moving_hp,
+	moving_color,
+	moving_id,
+	count,
+};
+
+struct snapshot_section
+{
+	uint64_t offset = 0u;
+	uint64_t bytes = 0u;
+};
+
+struct snapshot_header
+{
+	char		magic[8] = {};
+	uint32_t	version = SNAPSHOT_VERSION;
+	uint32_t	headerSize = 0u;
+	// Next frame to simulate
+	uint32_t	frame = 0u;
+	uint32_t	flags = 0u;
+
+	// Scene the snapshot came from. Replaces the config of the run that loads it
+	uint32_t	numStationaryCircles = 0u;
+	uint32_t	numMovingCircles = 0u;
+	uint32_t	seed = 0u;
+	// Stationary circles still in the collision arrays. Fewer than numStationaryCircles once some have been destroyed,
+	// the HP and color arrays always have one for every stationary circle
+	uint32_t	numStationaryRemaining = 0u;
+	float		xSpawnRange[2] = {};
+	float		ySpawnRange[2] = {};
+	float		xVelocityRange[2] = {};
+	float		yVelocityRange[2] = {};
+	float		radiusRange[2] = {};
+
+	snapshot_section sections[static_cast<size_t>(snapshot_section_id::count)];
+};
+
+static_assert(sizeof(snapshot_header) == 304, "Snapshot header layout changed");
+// Stationary HP is mapped straight into the atomics
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "Stationary HP atomics must be plain integers in memory");
+static_assert(sizeof(circle_color) == 3u * sizeof(float), "Colors are stored as 3 floats");
+
+#pragma endregion
+
+// Writes the state at the end of a frame. frame is the next one to simulate
+// Goes to a temporary file first so a crash while writing never replaces a good snapshot with a broken one
+// Throws std::runtime_error if the file can't be written
+void write_snapshot(const std::string& path, uint32_t frame, const simulation_config& config,
+	const stationary_collision_array& sColData, const stationary_unique_array& sUniqueArray, const std::atomic<int32_t>* sHP,
+	const moving_collision_array& mColData, const moving_unique_array& mUniqueArray);
+
+// Maps a snapshot copy on write and points every circle array straight into it
+// Pages are only read from disk when first touched and only copied when first written, so loading takes no time at all
+// The scene part of config and frame are replaced with the snapshots. The returned mapping must outlive the arrays
+// Throws std::runtime_error if the file isn't a snapshot this build can use
+std::unique_ptr<mapped_file> load_snapshot(const std::string& path, simulation_config& config, uint32_t& frame,
+	stationary_collision_array& sColData, stationary_unique_array& sUniqueArray, std::atomic<int32_t>*& sHP,
+	moving_collision_array& mColData, moving_unique_array& mUniqueArray);
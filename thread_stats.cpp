@@ -0,0 +1,84 @@
+#include "thread_stats.hpp"
+
+#include <stdexcept>
+
+namespace
+{
+	bool ends_with(const std::string& text, const std::string& ending)
+	{
+		return text.size() >= ending.size() && text.compare(text.size() - ending.size(), ending.size(), ending) == 0;
+	}
+
+	constexpr double MICROSECONDS = 1000000.0;
+}
+
+thread_stats_writer::thread_stats_writer(const std::string& path) : m_Path(path), m_File(path), m_ChromeTrace(ends_with(path, ".json"))
+{
+	if (!m_File)
+	{
+		throw std::runtime_error("Could not open thread stats file " + path);
+	}
+
+	// Microseconds to the nearest nanosecond
+	m_File.setf(std::ios::fixed);
+	m_File.precision(3);
+
+	if (m_ChromeTrace)
+	{
+		// The closing ] is optional in the trace format, which is handy as the simulation never ends cleanly
+		m_File << "[\n";
+	}
+	else
+	{
+		m_File << "frame,phase,thread,dispatch_us,wake_latency_us,compute_us,idle_us,candidates_tested,hits\n";
+	}
+}
+
+void thread_stats_writer::end_frame()
+{
+	for (const auto& record : m_FrameRecords)
+	{
+		if (m_ChromeTrace)
+		{
+			write_trace(record);
+		}
+		else
+		{
+			write_csv(record);
+		}
+	}
+	m_FrameRecords.clear();
+
+	m_File.flush();
+}
+
+void thread_stats_writer::write_csv(const thread_phase_record& record)
+{
+	m_File << record.frame << ',' << work_phase_name(record.phase) << ',' << record.threadIndex << ','
+		<< record.dispatchTime * MICROSECONDS << ',' << record.wakeLatency * MICROSECONDS << ','
+		<< record.computeTime * MICROSECONDS << ',' << record.idleTime * MICROSECONDS << ','
+		<< record.candidatesTested << ',' << record.hits << '\n';
+}
+
+void thread_stats_writer::write_trace(const thread_phase_record& record)
+{
+	// Each record becomes three back to back slices on the threads row: waking up, the phase itself, then idle at the barrier
+	const auto slice = [&](const char* name, double start, double duration, bool withArgs)
+	{
+		m_File << (m_FirstTraceEvent ? "" : ",\n");
+		m_FirstTraceEvent = false;
+
+		m_File << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.threadIndex
+			<< ",\"ts\":" << start * MICROSECONDS << ",\"dur\":" << duration * MICROSECONDS;
+		if (withArgs)
+		{
+			m_File << ",\"args\":{\"frame\":" << record.frame << ",\"candidates_tested\":" << record.candidatesTested << ",\"hits\":" << record.hits << '}';
+		}
+		m_File << '}';
+	};
+
+	const auto jobStart = record.dispatchTime + record.wakeLatency;
+	slice("wake", record.dispatchTime, record.wakeLatency, false);
+	slice(work_phase_name(record.phase), jobStart, record.computeTime, true);
+	slice("idle", jobStart + record.computeTime, record.idleTime, false);
+}
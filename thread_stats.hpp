@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "defines.hpp"
+
+// One threads share of one phase of a frame. Times are in seconds
+struct thread_phase_record
+{
+	uint32_t	frame = 0u;
+	work_phase	phase = work_phase::collide_stationary;
+	// Main thread is the last index like everywhere else
+	uint32_t	threadIndex = 0u;
+
+	// When the phase was dispatched, relative to when recording started
+	double		dispatchTime = 0.0;
+	// Dispatch until this thread started its job
+	double		wakeLatency = 0.0;
+	// Running the job
+	double		computeTime = 0.0;
+	// Finishing the job until the main thread saw everyone had finished
+	double		idleTime = 0.0;
+
+	// Circles that passed the broadphase and went through the narrow phase test
+	uint64_t	candidatesTested = 0u;
+	uint32_t	hits = 0u;
+};
+
+// Writes per-thread phase records to a file as the simulation runs
+// A path ending in .json is written as a Chrome trace (chrome://tracing or ui.perfetto.dev), anything else as CSV
+// Each frame is written and flushed as it ends, as the simulation normally runs until it is killed
+class thread_stats_writer
+{
+public:
+	// Throws std::runtime_error if the file can't be opened
+	explicit thread_stats_writer(const std::string& path);
+
+	void add(const thread_phase_record& record) { m_FrameRecords.push_back(record); }
+
+	// Writes everything added since the last call
+	void end_frame();
+
+	const std::string& path() const { return m_Path; }
+
+private:
+	void write_csv(const thread_phase_record& record);
+	void write_trace(const thread_phase_record& record);
+
+	std::string		m_Path;
+	std::ofstream	m_File;
+	bool			m_ChromeTrace = false;
+	bool			m_FirstTraceEvent = true;
+
+	std::vector<thread_phase_record> m_FrameRecords;
+};
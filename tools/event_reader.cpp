@@ -0,0 +1,181 @@
+// Reads a collision event file written with _RECORD_COLLISION_EVENTS_
+// The file is mapped and read in place. A chunk cut short at the end of the file is reported and skipped
+//
+// event_reader <file> [--csv] [--frame N]
+// Prints a summary of hits per frame by default. --csv prints every event instead. --frame only looks at one frame
+
+#include "collision_events.hpp"
+#include "libraries/mapped_file.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	struct reader_options
+	{
+		std::string	path;
+		bool		csv = false;
+		bool		filterFrame = false;
+		uint32_t	frame = 0u;
+	};
+
+	struct frame_summary
+	{
+		uint64_t stationaryHits = 0u;
+		uint64_t movingHits = 0u;
+	};
+
+	reader_options parse_options(int argc, char* argv[])
+	{
+		reader_options options;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--csv")
+			{
+				options.csv = true;
+			}
+			else if (arg == "--frame" && i + 1 < argc)
+			{
+				options.filterFrame = true;
+				options.frame = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (options.path.empty() && arg.rfind("--", 0) != 0)
+			{
+				options.path = arg;
+			}
+			else
+			{
+				throw std::runtime_error("Unknown option " + arg + ". Usage: event_reader <file> [--csv] [--frame N]");
+			}
+		}
+
+		if (options.path.empty())
+		{
+			throw std::runtime_error("No event file given. Usage: event_reader <file> [--csv] [--frame N]");
+		}
+		return options;
+	}
+
+	const event_file_header& read_header(const mapped_file& file)
+	{
+		if (file.size() < sizeof(event_file_header))
+		{
+			throw std::runtime_error("Too small to be an event file");
+		}
+
+		const auto& header = *reinterpret_cast<const event_file_header*>(file.data());
+		if (std::memcmp(header.magic, EVENT_FILE_MAGIC, sizeof(header.magic)) != 0)
+		{
+			throw std::runtime_error("Not an event file");
+		}
+		if (header.version != EVENT_FILE_VERSION)
+		{
+			throw std::runtime_error("Event file version " + std::to_string(header.version) + " but this reader is version " + std::to_string(EVENT_FILE_VERSION));
+		}
+		if (header.headerSize != sizeof(event_file_header) || header.chunkHeaderSize != sizeof(event_chunk_header) || header.eventSize != sizeof(collision_event))
+		{
+			throw std::runtime_error("Event file record sizes don't match this reader");
+		}
+		return header;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const auto options = parse_options(argc, argv);
+
+		const mapped_file file(options.path);
+		const auto& header = read_header(file);
+
+		if (options.csv)
+		{
+			std::cout << "frame,thread,kind,moving,other,normal_x,normal_y,moving_hp,other_hp\n";
+		}
+
+		std::map<uint32_t, frame_summary> frames;
+		uint64_t numChunks = 0u;
+		uint64_t numEvents = 0u;
+
+		size_t offset = header.headerSize;
+		while (offset < file.size())
+		{
+			if (file.size() - offset < sizeof(event_chunk_header))
+			{
+				std::cerr << "Warning: " << file.size() - offset << " bytes of a truncated chunk header at the end of the file\n";
+				break;
+			}
+
+			const auto& chunk = *reinterpret_cast<const event_chunk_header*>(file.data() + offset);
+			if (chunk.magic != EVENT_CHUNK_MAGIC)
+			{
+				throw std::runtime_error("Bad chunk at byte " + std::to_string(offset));
+			}
+
+			const auto chunkSize = sizeof(event_chunk_header) + static_cast<size_t>(chunk.eventCount) * sizeof(collision_event);
+			if (file.size() - offset < chunkSize)
+			{
+				std::cerr << "Warning: chunk at byte " << offset << " is truncated, skipped\n";
+				break;
+			}
+
+			const auto events = reinterpret_cast<const collision_event*>(file.data() + offset + sizeof(event_chunk_header));
+			offset += chunkSize;
+			++numChunks;
+
+			// Chunks know their frame range so most can be skipped when only one frame is wanted
+			if (options.filterFrame && (options.frame < chunk.firstFrame || options.frame > chunk.lastFrame))
+			{
+				continue;
+			}
+
+			for (auto i = 0u; i < chunk.eventCount; ++i)
+			{
+				const auto& event = events[i];
+				if (options.filterFrame && event.frame != options.frame)
+				{
+					continue;
+				}
+
+				++numEvents;
+				const bool moving = event.kind == collision_event_kind::moving_moving;
+
+				if (options.csv)
+				{
+					std::cout << event.frame << ',' << chunk.threadIndex << ',' << (moving ? 'M' : 'S') << ',' << event.movingId << ','
+						<< event.otherId << ',' << event.normalX << ',' << event.normalY << ',' << event.movingHP << ',' << event.otherHP << '\n';
+				}
+				else
+				{
+					auto& summary = frames[event.frame];
+					++(moving ? summary.movingHits : summary.stationaryHits);
+				}
+			}
+		}
+
+		if (!options.csv)
+		{
+			std::cout << "Stationary Circles: " << header.numStationaryCircles << " Moving Circles: " << header.numMovingCircles << " Seed: " << header.seed << '\n';
+			std::cout << "Chunks: " << numChunks << " Events: " << numEvents << '\n';
+			for (const auto& frame : frames)
+			{
+				std::cout << "Frame " << frame.first << ": " << frame.second.stationaryHits + frame.second.movingHits << " hits ("
+					<< frame.second.stationaryHits << " stationary, " << frame.second.movingHits << " moving)\n";
+			}
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something went wrong! Msg: " << e.what();
+		return -1;
+	}
+
+	return 0;
+}